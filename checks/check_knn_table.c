@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <knn/knn.h>
+
+// Vérifie la mise à jour incrémentale de la table des voisins : après une
+// série de knn_model_add_rating() + knn_table_update() (users et items
+// nouveaux compris), chaque ligne doit être celle d'une table recalculée
+// entièrement sur le modèle à jour, et la liste des users de chaque item
+// doit suivre ses notes.
+// Usage: check_knn_table
+
+#define NUM_RATINGS 3000
+#define NUM_USERS 200
+#define NUM_ITEMS 120
+#define NUM_UPDATES 200
+#define K 10
+
+int main(void)
+{
+    uint32_t *users = malloc(NUM_RATINGS * sizeof(uint32_t));
+    uint32_t *items = malloc(NUM_RATINGS * sizeof(uint32_t));
+    uint8_t *values = malloc(NUM_RATINGS);
+    if (users == NULL || items == NULL || values == NULL) {
+        fprintf(stderr, "Error: allocation failed\n");
+        return EXIT_FAILURE;
+    }
+    srand(2);
+    for (size_t t = 0; t < NUM_RATINGS; t++) {
+        users[t] = (uint32_t)(rand() % NUM_USERS);
+        items[t] = (uint32_t)(rand() % NUM_ITEMS);
+        values[t] = (uint8_t)(10 + rand() % 41);
+    }
+
+    int ok = 0;
+    rating_store_t store;
+    knn_model_t *model = NULL;
+    knn_table_t table, fresh;
+    memset(&store, 0, sizeof(store));
+    memset(&table, 0, sizeof(table));
+    memset(&fresh, 0, sizeof(fresh));
+    if (store_build(&store, users, items, values, NUM_RATINGS, NUM_USERS, NUM_ITEMS) != 0 ||
+        (model = knn_model_build(&store)) == NULL || knn_table_init(&table, NUM_USERS, K) != 0 ||
+        knn_table_build(&table, model) != 0) {
+        fprintf(stderr, "Error: construction du modèle ou de la table impossible\n");
+        goto done;
+    }
+
+    for (int r = 0; r < NUM_UPDATES; r++) {
+        uint32_t user = (uint32_t)(rand() % (NUM_USERS + 20));
+        uint32_t item = (uint32_t)(rand() % (NUM_ITEMS + 10));
+        if (knn_model_add_rating(model, user, item, 1 + rand() % 5) != 0 ||
+            knn_table_update(&table, model, user, item) != 0) {
+            fprintf(stderr, "Error: mise à jour (%u, %u) impossible\n", user, item);
+            goto done;
+        }
+    }
+
+    if (knn_table_init(&fresh, model->num_users, K) != 0 || knn_table_build(&fresh, model) != 0) {
+        fprintf(stderr, "Error: recalcul de la table impossible\n");
+        goto done;
+    }
+
+    // Les lignes encore à jour doivent être identiques au recalcul ; les
+    // autres doivent l'être une fois rafraîchies par knn_table_neighborhood()
+    size_t bad = 0, stale = 0;
+    for (uint32_t u = 0; u < model->num_users; u++) {
+        const uint32_t *expected = fresh.neighbors + (size_t)u * K;
+        if (u < table.num_users && !table.stale[u]) {
+            if (memcmp(table.neighbors + (size_t)u * K, expected, K * sizeof(uint32_t)) != 0) {
+                fprintf(stderr, "Error: ligne %u différente du recalcul\n", u);
+                bad++;
+            }
+            continue;
+        }
+        stale++;
+        knn_neighborhood_t nb;
+        if (knn_table_neighborhood(&table, model, u, K, &nb) != 0) {
+            fprintf(stderr, "Error: voisinage de %u impossible\n", u);
+            bad++;
+            continue;
+        }
+        for (size_t j = 0; j < K; j++) {
+            uint32_t got = j < nb.len ? nb.users[j] : KNN_TABLE_NONE;
+            if (got != expected[j]) {
+                fprintf(stderr, "Error: ligne %u rafraîchie différente du recalcul\n", u);
+                bad++;
+                break;
+            }
+        }
+        knn_neighborhood_free(&nb);
+    }
+
+    for (size_t i = 0; i < model->num_items; i++) {
+        if (model->raters[i].len != model->item_count[i]) {
+            fprintf(stderr, "Error: item %zu : %zu users pour %zu notes\n", i,
+                    model->raters[i].len, (size_t)model->item_count[i]);
+            bad++;
+        }
+    }
+
+    printf("knn table: %zu users (%zu lignes à rafraîchir) : %s\n", (size_t)model->num_users, stale,
+           bad == 0 ? "OK" : "FAILED");
+    ok = bad == 0;
+
+done:
+    knn_table_free(&fresh);
+    knn_table_free(&table);
+    knn_model_free(model);
+    store_free(&store);
+    free(users);
+    free(items);
+    free(values);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,171 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mf/mf.h>
+
+// Vérifie le modèle MF : mf_model_save() puis mf_model_load() rendent les
+// mêmes facteurs et les mêmes scores, mf_model_verify() accepte le fichier
+// écrit et rejette un corps modifié, et mf_fold_in_user() atteint l'optimum
+// de son système régularisé (gradient nul).
+// Usage: check_mf [fichier temporaire]
+
+#define NUM_SAMPLES 4000
+#define NUM_USERS 150
+#define NUM_ITEMS 80
+#define FOLD_IN_RATINGS 25
+#define LAMBDA 0.1
+
+// Compare les lignes compactées de deux modèles
+static int same_rows(const char *what, const float *a, const float *b, size_t rows, size_t stride)
+{
+    if (memcmp(a, b, rows * stride * sizeof(float)) != 0) {
+        fprintf(stderr, "Error: %s différents après rechargement\n", what);
+        return 0;
+    }
+    return 1;
+}
+
+// Conditions d'optimalité de min sum (r - P[i] - <u, y> - b)² + lambda n (|u|² + b²) :
+// sum e y = lambda n u et sum e = lambda n b, e étant le résidu de chaque note
+static int fold_in_is_optimal(const mf_model_t *model, size_t user, const uint32_t *items,
+                              const float *ratings, size_t n, double lambda)
+{
+    size_t k = model->k;
+    const float *u = model->user_factors + user * model->stride;
+    double bias = model->user_bias[user];
+    double *gradient = calloc(k + 1, sizeof(double));
+    if (gradient == NULL) {
+        return 0;
+    }
+    for (size_t t = 0; t < n; t++) {
+        const float *y = model->item_factors + (size_t)items[t] * model->stride;
+        double e = ratings[t] - model->item_bias[items[t]] - bias;
+        for (size_t i = 0; i < k; i++) {
+            e -= (double)u[i] * y[i];
+        }
+        for (size_t i = 0; i < k; i++) {
+            gradient[i] += e * y[i];
+        }
+        gradient[k] += e;
+    }
+    double worst = 0.0;
+    for (size_t i = 0; i <= k; i++) {
+        double x = i < k ? u[i] : bias;
+        double g = fabs(gradient[i] - lambda * n * x);
+        worst = g > worst ? g : worst;
+    }
+    free(gradient);
+    if (worst > 1e-3) {
+        fprintf(stderr, "Error: fold-in de %zu loin de l'optimum (gradient %g)\n", user, worst);
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = argc > 1 ? argv[1] : "check_mf_model.bin";
+    mf_sample_t *samples = malloc(NUM_SAMPLES * sizeof(mf_sample_t));
+    uint64_t *user_ids = malloc(NUM_USERS * sizeof(uint64_t));
+    uint64_t *item_ids = malloc(NUM_ITEMS * sizeof(uint64_t));
+    float *before = malloc(NUM_ITEMS * sizeof(float));
+    float *after = malloc(NUM_ITEMS * sizeof(float));
+    if (samples == NULL || user_ids == NULL || item_ids == NULL || before == NULL || after == NULL) {
+        fprintf(stderr, "Error: allocation failed\n");
+        return EXIT_FAILURE;
+    }
+    srand(3);
+    for (size_t t = 0; t < NUM_SAMPLES; t++) {
+        samples[t].user = (uint32_t)(rand() % NUM_USERS);
+        samples[t].item = (uint32_t)(rand() % NUM_ITEMS);
+        samples[t].rating = (float)(1 + rand() % 5);
+    }
+    for (size_t u = 0; u < NUM_USERS; u++) {
+        user_ids[u] = 1000 + u;
+    }
+    for (size_t i = 0; i < NUM_ITEMS; i++) {
+        item_ids[i] = 5000 + i;
+    }
+
+    int ok = 0;
+    mf_model_t *loaded = NULL;
+    mf_params_t params = { 8, 0.01, LAMBDA, 5, NULL, 42, MF_SOLVER_ALS };
+    mf_model_t *model = mf_train_samples(samples, NUM_SAMPLES, NUM_USERS, NUM_ITEMS, &params);
+    if (model == NULL) {
+        fprintf(stderr, "Error: entraînement impossible\n");
+        goto done;
+    }
+
+    if (mf_model_save(model, user_ids, item_ids, path) != 0 || mf_model_verify(path) != 0 ||
+        (loaded = mf_model_load(path, NULL, NULL)) == NULL) {
+        fprintf(stderr, "Error: aller-retour par %s impossible\n", path);
+        goto done;
+    }
+    if (loaded->num_users != model->num_users || loaded->num_items != model->num_items ||
+        loaded->k != model->k || loaded->stride != model->stride) {
+        fprintf(stderr, "Error: dimensions différentes après rechargement\n");
+        goto done;
+    }
+    ok = same_rows("facteurs users", model->user_factors, loaded->user_factors, NUM_USERS, model->stride) &&
+         same_rows("facteurs items", model->item_factors, loaded->item_factors, NUM_ITEMS, model->stride) &&
+         same_rows("biais users", model->user_bias, loaded->user_bias, NUM_USERS, 1) &&
+         same_rows("biais items", model->item_bias, loaded->item_bias, NUM_ITEMS, 1);
+    for (size_t u = 0; ok && u < NUM_USERS; u += 7) {
+        if (mf_score_user(model, u, NULL, NUM_ITEMS, before) != 0 ||
+            mf_score_user(loaded, u, NULL, NUM_ITEMS, after) != 0 ||
+            memcmp(before, after, NUM_ITEMS * sizeof(float)) != 0) {
+            fprintf(stderr, "Error: scores de %zu différents après rechargement\n", u);
+            ok = 0;
+        }
+    }
+    mf_model_release(loaded);
+    loaded = NULL;
+
+    // Un octet modifié dans le corps : le chargement passe, la vérification non
+    if (ok) {
+        printf("corps modifié (erreur de checksum attendue)\n");
+        fflush(stdout);
+        FILE *file = fopen(path, "r+b");
+        int c;
+        if (file == NULL || fseek(file, -1, SEEK_END) != 0 || (c = fgetc(file)) == EOF ||
+            fseek(file, -1, SEEK_END) != 0 || fputc(c ^ 0x5a, file) == EOF || fclose(file) != 0) {
+            fprintf(stderr, "Error: modification de %s impossible\n", path);
+            ok = 0;
+        } else if (mf_model_verify(path) == 0) {
+            fprintf(stderr, "Error: corps modifié non détecté par mf_model_verify\n");
+            ok = 0;
+        }
+    }
+
+    // Fold-in d'un user existant puis d'un nouveau (le modèle s'agrandit)
+    uint32_t items[FOLD_IN_RATINGS];
+    float ratings[FOLD_IN_RATINGS];
+    for (size_t t = 0; t < FOLD_IN_RATINGS; t++) {
+        items[t] = (uint32_t)(rand() % NUM_ITEMS);
+        ratings[t] = (float)(1 + rand() % 5);
+    }
+    size_t fold_users[2] = { 3, NUM_USERS + 4 };
+    for (size_t j = 0; ok && j < 2; j++) {
+        if (mf_fold_in_user(model, fold_users[j], items, ratings, FOLD_IN_RATINGS, LAMBDA) != 0) {
+            fprintf(stderr, "Error: fold-in de %zu impossible\n", fold_users[j]);
+            ok = 0;
+        } else {
+            ok = fold_in_is_optimal(model, fold_users[j], items, ratings, FOLD_IN_RATINGS, LAMBDA);
+        }
+    }
+
+    printf("mf: %s\n", ok ? "OK" : "FAILED");
+
+done:
+    mf_model_release(loaded);
+    mf_model_release(model);
+    remove(path);
+    free(samples);
+    free(user_ids);
+    free(item_ids);
+    free(before);
+    free(after);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
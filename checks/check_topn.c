@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <core/topn.h>
+
+// Vérifie l'ordre de classement de topn (score décroissant puis id
+// croissant) avec beaucoup d'égalités : le résultat ne doit dépendre ni de
+// l'ordre d'arrivée des candidats, ni du chemin (tas ou topn_select).
+// Usage: check_topn
+
+#define NUM_CANDIDATES 2000
+#define NUM_TOP 50
+#define NUM_ROUNDS 20
+
+// Le classement attendu : a passe-t-il avant b ?
+static int ranks_before(const scored_id_t *a, const scored_id_t *b)
+{
+    return a->score > b->score || (a->score == b->score && a->id < b->id);
+}
+
+static int by_rank(const void *a, const void *b)
+{
+    const scored_id_t *x = a, *y = b;
+    return ranks_before(x, y) ? -1 : ranks_before(y, x) ? 1 : 0;
+}
+
+static int same_ranking(const char *what, const scored_id_t *got, size_t got_len,
+                        const scored_id_t *expected, size_t expected_len)
+{
+    if (got_len != expected_len) {
+        fprintf(stderr, "Error: %s: %zu candidats au lieu de %zu\n", what, got_len, expected_len);
+        return 0;
+    }
+    for (size_t i = 0; i < got_len; i++) {
+        if (got[i].id != expected[i].id || got[i].score != expected[i].score) {
+            fprintf(stderr, "Error: %s: rang %zu = (%u, %g) au lieu de (%u, %g)\n", what, i,
+                    got[i].id, got[i].score, expected[i].id, expected[i].score);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(void)
+{
+    scored_id_t *candidates = malloc(NUM_CANDIDATES * sizeof(scored_id_t));
+    scored_id_t *expected = malloc(NUM_CANDIDATES * sizeof(scored_id_t));
+    scored_id_t *work = malloc(NUM_CANDIDATES * sizeof(scored_id_t));
+    topn_t top;
+    if (candidates == NULL || expected == NULL || work == NULL || topn_init(&top, NUM_TOP) != 0) {
+        fprintf(stderr, "Error: allocation failed\n");
+        return EXIT_FAILURE;
+    }
+
+    // Peu de scores distincts : la plupart des places se jouent à l'id
+    srand(1);
+    for (size_t i = 0; i < NUM_CANDIDATES; i++) {
+        candidates[i].id = (uint32_t)i;
+        candidates[i].score = (double)(rand() % 8) / 2.0;
+    }
+    for (size_t i = 0; i < NUM_CANDIDATES; i++) {
+        expected[i] = candidates[i];
+    }
+    qsort(expected, NUM_CANDIDATES, sizeof(scored_id_t), by_rank);
+
+    int ok = 1;
+    for (int round = 0; round < NUM_ROUNDS && ok; round++) {
+        // Ordre d'arrivée différent à chaque tour (le premier dans l'ordre des ids)
+        for (size_t i = NUM_CANDIDATES - 1; round > 0 && i > 0; i--) {
+            size_t j = (size_t)rand() % (i + 1);
+            scored_id_t tmp = candidates[i];
+            candidates[i] = candidates[j];
+            candidates[j] = tmp;
+        }
+
+        for (size_t i = 0; i < NUM_CANDIDATES; i++) {
+            if (topn_accepts(&top, candidates[i].id, candidates[i].score)) {
+                topn_push(&top, candidates[i].id, candidates[i].score);
+            }
+        }
+        size_t len = topn_finish(&top);
+        ok = same_ranking("topn_push", top.heap, len, expected, NUM_TOP);
+
+        for (size_t i = 0; i < NUM_CANDIDATES; i++) {
+            work[i] = candidates[i];
+        }
+        len = topn_select(work, NUM_CANDIDATES, NUM_TOP);
+        ok = ok && same_ranking("topn_select", work, len, expected, NUM_TOP);
+    }
+
+    // N plus grand que le nombre de candidats : tout est gardé, trié
+    for (size_t i = 0; i < NUM_CANDIDATES; i++) {
+        work[i] = candidates[i];
+    }
+    size_t len = topn_select(work, NUM_CANDIDATES, NUM_CANDIDATES + 10);
+    ok = ok && same_ranking("topn_select (tout)", work, len, expected, NUM_CANDIDATES);
+
+    printf("topn: %s\n", ok ? "OK" : "FAILED");
+    topn_free(&top);
+    free(candidates);
+    free(expected);
+    free(work);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
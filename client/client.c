@@ -324,6 +324,8 @@ int parse_recommendation_command(const char *input, recommendation_request_t *re
                 req->algorithm = ALGO_MF;
             } else if (strcasecmp(algo_str, "graph") == 0) {
                 req->algorithm = ALGO_GRAPH;
+            } else if (strcasecmp(algo_str, "itemknn") == 0) {
+                req->algorithm = ALGO_ITEM_KNN;
             } else {
                 printf("Invalid algorithm '%s'. Using KNN as default.\n", algo_str);
                 printf("Using KNN as default with k = %d.\n", DEFAULT_K);
@@ -346,8 +348,8 @@ void show_recommendation_help() {
     printf("Available commands:\n");
     printf("  /help                        - Show this help\n");
     printf("  /recommend <uid> <algo> [k] [n] [cat] - Get recommendations\n");
-    printf("      uid: User ID (0-%d)\n", MAX_USERS-1);
-    printf("      algo: knn, mf, graph\n");
+    printf("      uid: User ID\n");
+    printf("      algo: knn, mf, graph, itemknn\n");
     printf("      k value: set to 0 if algo is not knn\n");
     printf("      n: Number of recommendations (1-%d, default: 5)\n", MAX_RECOMMENDATIONS);
     printf("      cat: Category filter (-1 for none, default: -1)\n");
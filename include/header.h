@@ -6,19 +6,82 @@
 #include <netinet/in.h>
 #include <time.h>
 
+#include <core/store.h>
+#include <core/id_map.h>
+#include <core/rating_log.h>
+#include <core/snapshot.h>
+#include <core/ingest.h>
+#include <core/dataset.h>
+#include <core/topn.h>
+#include <core/kernels.h>
+#include <core/pool.h>
+
 // Configuration constants
 #define DEFAULT_PORT 8080
 #define SERVER_IP "127.0.0.1"  // Add missing SERVER_IP
 #define MAX_CLIENT 10
 #define MAX_MESSAGE_LENGTH 1024
 #define CLIENT_TIMEOUT 300
-#define MAX_RATINGS 10000
-#define MAX_USERS 9999
-#define MAX_ITEMS 9999
 #define MAX_RECOMMENDATIONS 20
 
 #define DEFAULT_K 3 
 
+// Fichiers de données
+#define RATINGS_FILE "server/data/ratings.txt"
+#define SNAPSHOT_FILE "server/data/ratings.snap"   // généré par bin/make_snapshot
+#define KNN_TABLE_FILE "server/data/knn_table.bin" // généré par bin/build_knn_table
+#define KNN_HNSW_FILE "server/data/knn_hnsw.bin"   // généré par bin/build_knn_hnsw
+// Tables de bin/build_allpairs : item_pairs amorce l'index item-item au
+// démarrage, user_pairs ne sert qu'hors ligne (le serveur lit KNN_TABLE_FILE)
+#define USER_PAIRS_FILE "server/data/user_pairs.bin"
+#define ITEM_PAIRS_FILE "server/data/item_pairs.bin"
+#define MF_MODEL_FILE "server/data/mf_model.bin"    // écrit par l'entraîneur MF ou bin/train_mf
+
+// 1 : le serveur vérifie tout le snapshot à l'ouverture (O(taille du
+// fichier)) ; make_snapshot le fait déjà après l'écriture
+#define SNAPSHOT_VERIFY 0
+
+// Factorisation matricielle : hyperparamètres de l'entraînement, et
+// croissance du journal (en %) au-delà de laquelle le modèle est réentraîné
+// en tâche de fond
+#define MF_FACTORS 10
+#define MF_LEARNING_RATE 0.01
+#define MF_REGULARIZATION 0.1
+#define MF_EPOCHS 20
+#define MF_SOLVER MF_SOLVER_ALS   // MF_SOLVER_SGD ou MF_SOLVER_ALS
+#define MF_ALS_ITERATIONS 8
+#define MF_RETRAIN_PERCENT 10
+#define MF_TRAIN_INTERVAL 5        // secondes entre deux vérifications de l'entraîneur MF
+
+// Au-delà de MF_MIPS_MIN_ITEMS items, les recommandations MF viennent d'un
+// index MIPS (approché) plutôt que du score de tous les items. NPROBE règle
+// le compromis rappel / latence (voir bin/mips_report) ; LISTS = 0 : environ
+// racine du nombre d'items.
+#define MF_MIPS_MIN_ITEMS 20000
+#define MF_MIPS_LISTS 0
+#define MF_MIPS_NPROBE 32
+
+// Threads du pool de calcul partagé par les moteurs (0 = un par coeur)
+#define WORKER_THREADS 0
+
+// Nombre de voisins gardés par user dans la table KNN précalculée
+#define KNN_TABLE_K 32
+
+// Nombre de voisins gardés par item pour le KNN item-item, et croissance
+// du journal (en %) au-delà de laquelle l'index est reconstruit
+#define ITEM_KNN_M 50
+#define ITEM_KNN_REBUILD_PERCENT 10
+
+// Au-delà de KNN_HNSW_MIN_USERS users, les voisins KNN viennent de l'index
+// HNSW (approché) de KNN_HNSW_FILE s'il correspond aux données, plutôt que
+// d'un balayage de tous les users. EF_SEARCH règle le compromis rappel /
+// latence (voir bin/hnsw_report) ; M et EF_CONSTRUCTION servent à
+// bin/build_knn_hnsw.
+#define KNN_HNSW_MIN_USERS 100000
+#define KNN_HNSW_M 16
+#define KNN_HNSW_EF_CONSTRUCTION 200
+#define KNN_HNSW_EF_SEARCH 100
+
 typedef struct date
 {
     int day;
@@ -26,12 +89,6 @@ typedef struct date
     int year;
 }date_t;
 
-// Définition temporaire de la structure ItemScore
-typedef struct {
-    int item_id;
-    double score;
-} ItemScore;
-
 // Message types
 typedef enum {
     MSG_RECOMMENDATION,  
@@ -41,18 +98,10 @@ typedef enum {
 typedef enum {
     ALGO_KNN = 1,
     ALGO_MF,
-    ALGO_GRAPH
+    ALGO_GRAPH,
+    ALGO_ITEM_KNN
 } recommendation_algo_t;
 
-// Rating structure
-typedef struct {
-    long user_id;
-    long item_id;
-    long category_id;
-    double rating;
-    double timestamp;
-} rating_t;
-
 // Recommendation request structure
 typedef struct {
     long user_id;
@@ -92,9 +141,19 @@ typedef struct {
 
 // Recommendation system data structures
 typedef struct {
-    rating_t ratings[MAX_RATINGS];
-    long num_ratings;
-    long user_item_matrix[MAX_USERS][MAX_ITEMS];
+    rating_log_t log;                 // Journal des ratings en colonnes (index denses)
+    id_map_t users;                   // identifiant externe <-> index dense
+    id_map_t items;
+    rating_store_t store;             // Vues creuses CSR/CSC des notes (x10)
+    int store_dirty;                  // store à reconstruire après add_rating()
+    struct KNNModel *knn;             // modèle KNN persistant (knn/knn.h), suit add_rating()
+    struct KNNTable *knn_table;       // top K voisins par user, lignes recalculées à la demande
+    struct HNSW *knn_hnsw;            // index des voisins approchés (grands catalogues de users)
+    struct ItemKNN *item_knn;         // top M voisins par item, construit en tâche de fond
+    size_t item_knn_ratings;          // taille du journal lors de sa construction
+    thread_pool_t pool;               // workers des balayages KNN (pool_parallel_for)
+    snapshot_t snapshot;              // projection mmap dont log/users/items/store peuvent dépendre
+    uint64_t fingerprint;             // dataset_fingerprint() au chargement, 0 après add_rating()
     long num_users;
     long num_items;
     pthread_mutex_t data_mutex;
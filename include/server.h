@@ -23,13 +23,15 @@ extern recommendation_system_t rec_system;
 // Recommendation system functions
 void init_recommendation_system();
 void load_ratings_data(const char* filename);
-int add_rating(int user_id, int item_id, int category_id, float rating);
+int load_snapshot(const char* filename);
+int add_rating(long user_id, long item_id, int category_id, float rating);
 void get_recommendations(recommendation_request_t* request, recommendation_result_t* results, int* num_results);
 
 // Algorithm implementations
-void knn_recommendation(int user_id, int k, recommendation_result_t* results, int* num_results, int max_results);
-void matrix_factorization_recommendation(int user_id, recommendation_result_t* results, int* num_results, int max_results);
-void graph_recommendation(int user_id, recommendation_result_t* results, int* num_results, int max_results);
+void knn_recommendation(long user_id, int k, recommendation_result_t* results, int* num_results, int max_results);
+void matrix_factorization_recommendation(long user_id, recommendation_result_t* results, int* num_results, int max_results);
+void graph_recommendation(long user_id, recommendation_result_t* results, int* num_results, int max_results);
+void item_knn_recommendation(long user_id, recommendation_result_t* results, int* num_results, int max_results);
 
 // Global variables (extern declarations)
 extern client_t clients[MAX_CLIENT];
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "dataset.h"
+#include "ingest.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t mix(uint64_t hash, uint64_t word)
+{
+    return (hash ^ word) * FNV_PRIME;
+}
+
+uint64_t dataset_fingerprint(const id_map_t *users, const id_map_t *items, const rating_log_t *log)
+{
+    uint64_t hash = FNV_OFFSET;
+    hash = mix(hash, users->size);
+    hash = mix(hash, items->size);
+    hash = mix(hash, log->size);
+    for (size_t u = 0; u < users->size; u++) {
+        hash = mix(hash, users->external[u]);
+    }
+    for (size_t i = 0; i < items->size; i++) {
+        hash = mix(hash, items->external[i]);
+    }
+    for (size_t s = 0; s < rating_log_num_segments(log); s++) {
+        rating_columns_t col = rating_log_segment(log, s);
+        for (size_t i = 0; i < col.len; i++) {
+            hash = mix(hash, (uint64_t)col.user[i] | (uint64_t)col.item[i] << 32);
+            hash = mix(hash, col.rating[i]);
+        }
+    }
+    return hash;
+}
+
+int dataset_load(dataset_t *data, const char *snapshot_path, const char *ratings_path)
+{
+    memset(data, 0, sizeof(*data));
+    if (snapshot_open(snapshot_path, &data->snapshot, &data->users, &data->items, &data->log,
+                      &data->store) == 0) {
+        data->fingerprint = data->snapshot.fingerprint;
+        return 0;
+    }
+
+    ingest_stats_t stats;
+    if (ingest_ratings_file(ratings_path, 0, &data->users, &data->items, &data->log, &stats) != 0 ||
+        store_build_from_log(&data->store, &data->log, data->users.size, data->items.size) != 0) {
+        fprintf(stderr, "Error: Failed to load ratings data\n");
+        dataset_free(data);
+        return -1;
+    }
+    data->fingerprint = dataset_fingerprint(&data->users, &data->items, &data->log);
+    return 0;
+}
+
+void dataset_free(dataset_t *data)
+{
+    store_free(&data->store);
+    rating_log_free(&data->log);
+    id_map_free(&data->users);
+    id_map_free(&data->items);
+    snapshot_close(&data->snapshot);
+    memset(data, 0, sizeof(*data));
+}
@@ -0,0 +1,29 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include "id_map.h"
+#include "rating_log.h"
+#include "snapshot.h"
+#include "store.h"
+
+// Données de ratings chargées comme par le serveur : snapshot projeté s'il
+// est utilisable, sinon fichier texte analysé puis store construit
+typedef struct Dataset {
+    snapshot_t snapshot;     // projection dont les autres champs peuvent dépendre
+    id_map_t users;
+    id_map_t items;
+    rating_log_t log;
+    rating_store_t store;
+    uint64_t fingerprint;    // dataset_fingerprint() des données chargées
+} dataset_t;
+
+// Retourne 0 en cas de succès, -1 sinon (data est alors vide)
+extern int dataset_load(dataset_t *data, const char *snapshot_path, const char *ratings_path);
+extern void dataset_free(dataset_t *data);
+
+// Empreinte FNV-1a des dictionnaires et des colonnes user/item/note du
+// journal : un fichier dérivé (table de voisins, index) qui la garde n'est
+// réutilisé que sur exactement les mêmes données
+extern uint64_t dataset_fingerprint(const id_map_t *users, const id_map_t *items, const rating_log_t *log);
+
+#endif // DATASET_H
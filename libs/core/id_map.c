@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "id_map.h"
+
+// Mélangeur de splitmix64 : les identifiants séquentiels se répartissent
+// uniformément sur la table
+static uint64_t hash_id(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static void insert_slot(uint64_t *keys, uint32_t *slots, size_t capacity, uint64_t external, uint32_t dense)
+{
+    size_t mask = capacity - 1;
+    size_t pos = (size_t)hash_id(external) & mask;
+
+    while (slots[pos] != ID_MAP_NONE) {
+        pos = (pos + 1) & mask;
+    }
+    keys[pos] = external;
+    slots[pos] = dense;
+}
+
+static int rehash(id_map_t *map, size_t capacity)
+{
+    uint64_t *keys = malloc(capacity * sizeof(uint64_t));
+    uint32_t *slots = malloc(capacity * sizeof(uint32_t));
+    if (!keys || !slots) {
+        free(keys);
+        free(slots);
+        return -1;
+    }
+    memset(slots, 0xff, capacity * sizeof(uint32_t));
+
+    // Le tableau inverse contient toutes les clés : pas besoin de relire l'ancienne table
+    for (size_t d = 0; d < map->size; d++) {
+        insert_slot(keys, slots, capacity, map->external[d], (uint32_t)d);
+    }
+
+    free(map->keys);
+    free(map->slots);
+    map->keys = keys;
+    map->slots = slots;
+    map->capacity = capacity;
+    return 0;
+}
+
+int id_map_init(id_map_t *map, size_t expected)
+{
+    memset(map, 0, sizeof(*map));
+
+    size_t capacity = 16;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+    if (rehash(map, capacity) != 0) {
+        return -1;
+    }
+
+    map->external = malloc((expected ? expected : 1) * sizeof(uint64_t));
+    if (map->external == NULL) {
+        id_map_free(map);
+        return -1;
+    }
+    map->cap_external = expected ? expected : 1;
+    return 0;
+}
+
+void id_map_free(id_map_t *map)
+{
+    if (map == NULL) {
+        return;
+    }
+    if (!map->borrowed) {
+        free(map->keys);
+        free(map->slots);
+        free(map->external);
+    }
+    memset(map, 0, sizeof(*map));
+}
+
+// Copie en mémoire les tables empruntées avant toute modification
+static int detach(id_map_t *map)
+{
+    size_t cap_external = map->size > 16 ? map->size : 16;
+    uint64_t *keys = malloc(map->capacity * sizeof(uint64_t));
+    uint32_t *slots = malloc(map->capacity * sizeof(uint32_t));
+    uint64_t *external = malloc(cap_external * sizeof(uint64_t));
+
+    if (!keys || !slots || !external) {
+        free(keys);
+        free(slots);
+        free(external);
+        return -1;
+    }
+
+    memcpy(keys, map->keys, map->capacity * sizeof(uint64_t));
+    memcpy(slots, map->slots, map->capacity * sizeof(uint32_t));
+    memcpy(external, map->external, map->size * sizeof(uint64_t));
+    map->keys = keys;
+    map->slots = slots;
+    map->external = external;
+    map->cap_external = cap_external;
+    map->borrowed = 0;
+    return 0;
+}
+
+uint32_t id_map_find(const id_map_t *map, uint64_t external)
+{
+    if (map->capacity == 0) {
+        return ID_MAP_NONE;
+    }
+
+    size_t mask = map->capacity - 1;
+    size_t pos = (size_t)hash_id(external) & mask;
+
+    while (map->slots[pos] != ID_MAP_NONE) {
+        if (map->keys[pos] == external) {
+            return map->slots[pos];
+        }
+        pos = (pos + 1) & mask;
+    }
+    return ID_MAP_NONE;
+}
+
+uint32_t id_map_intern(id_map_t *map, uint64_t external)
+{
+    uint32_t dense = id_map_find(map, external);
+    if (dense != ID_MAP_NONE) {
+        return dense;
+    }
+    if (map->size >= ID_MAP_NONE - 1) {
+        return ID_MAP_NONE;
+    }
+    if (map->borrowed && detach(map) != 0) {
+        return ID_MAP_NONE;
+    }
+
+    // Facteur de charge maximal 1/2
+    if ((map->size + 1) * 2 > map->capacity) {
+        if (rehash(map, map->capacity ? map->capacity * 2 : 16) != 0) {
+            return ID_MAP_NONE;
+        }
+    }
+    if (map->size == map->cap_external) {
+        size_t cap = map->cap_external ? map->cap_external * 2 : 16;
+        uint64_t *external_ids = realloc(map->external, cap * sizeof(uint64_t));
+        if (external_ids == NULL) {
+            return ID_MAP_NONE;
+        }
+        map->external = external_ids;
+        map->cap_external = cap;
+    }
+
+    dense = (uint32_t)map->size;
+    map->external[dense] = external;
+    map->size++;
+    insert_slot(map->keys, map->slots, map->capacity, external, dense);
+    return dense;
+}
+
+uint64_t id_map_external(const id_map_t *map, uint32_t dense)
+{
+    if (dense >= map->size) {
+        return UINT64_MAX;
+    }
+    return map->external[dense];
+}
@@ -0,0 +1,38 @@
+#ifndef ID_MAP_H
+#define ID_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Index dense renvoyé quand un identifiant externe est inconnu
+#define ID_MAP_NONE UINT32_MAX
+
+// Dictionnaire identifiant externe (64 bits) -> index dense [0, size).
+// Table à adressage ouvert (sondage linéaire, facteur de charge <= 1/2)
+// et tableau inverse pour retrouver l'identifiant externe d'un index.
+// Une structure mise à zéro est un dictionnaire vide valide.
+// Un dictionnaire emprunté (tables d'un snapshot mmap) est copié en mémoire
+// au premier ajout.
+typedef struct IdMap {
+    uint64_t *keys;        // capacity cases
+    uint32_t *slots;       // index dense de chaque case, ID_MAP_NONE si vide
+    size_t capacity;       // puissance de 2
+    uint64_t *external;    // index dense -> identifiant externe
+    size_t size;
+    size_t cap_external;
+    int borrowed;          // tables en lecture seule, à ne pas libérer
+} id_map_t;
+
+extern int id_map_init(id_map_t *map, size_t expected);
+extern void id_map_free(id_map_t *map);
+
+// Retourne l'index dense de external, ou ID_MAP_NONE s'il est absent
+extern uint32_t id_map_find(const id_map_t *map, uint64_t external);
+
+// Retourne l'index dense de external en l'ajoutant s'il est absent.
+// Retourne ID_MAP_NONE en cas d'échec d'allocation.
+extern uint32_t id_map_intern(id_map_t *map, uint64_t external);
+
+extern uint64_t id_map_external(const id_map_t *map, uint32_t dense);
+
+#endif // ID_MAP_H
@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ingest.h"
+
+// Résultat de l'analyse d'un chunk, en colonnes, avec identifiants externes
+typedef struct ParsedChunk {
+    const char *begin;
+    const char *end;
+    uint64_t *user;
+    uint64_t *item;
+    uint32_t *category;
+    uint32_t *timestamp;
+    uint8_t *rating;
+    size_t len;
+    size_t cap;
+    size_t lines;
+    size_t rejected;
+    int failed;          // échec d'allocation
+} parsed_chunk_t;
+
+static int chunk_reserve(parsed_chunk_t *c)
+{
+    if (c->len < c->cap) {
+        return 0;
+    }
+
+    size_t cap = c->cap ? c->cap * 2 : 4096;
+    uint64_t *user = realloc(c->user, cap * sizeof(uint64_t));
+    if (user) c->user = user;
+    uint64_t *item = realloc(c->item, cap * sizeof(uint64_t));
+    if (item) c->item = item;
+    uint32_t *category = realloc(c->category, cap * sizeof(uint32_t));
+    if (category) c->category = category;
+    uint32_t *timestamp = realloc(c->timestamp, cap * sizeof(uint32_t));
+    if (timestamp) c->timestamp = timestamp;
+    uint8_t *rating = realloc(c->rating, cap * sizeof(uint8_t));
+    if (rating) c->rating = rating;
+
+    if (!user || !item || !category || !timestamp || !rating) {
+        return -1;
+    }
+    c->cap = cap;
+    return 0;
+}
+
+static void chunk_free(parsed_chunk_t *c)
+{
+    free(c->user);
+    free(c->item);
+    free(c->category);
+    free(c->timestamp);
+    free(c->rating);
+}
+
+static const char *skip_blanks(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+// Entier signé en base 10. Retourne la position après le nombre, NULL si invalide.
+static const char *parse_int(const char *p, const char *end, int64_t *out)
+{
+    int negative = 0;
+    int64_t value = 0;
+
+    p = skip_blanks(p, end);
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return NULL;
+    }
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (value > (INT64_MAX - 9) / 10) {
+            return NULL;
+        }
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    *out = negative ? -value : value;
+    return p;
+}
+
+// Nombre décimal positif converti en dixièmes, arrondi au plus proche
+// (ex. "4.25" -> 43). Les chiffres au-delà du centième sont ignorés.
+static const char *parse_tenths(const char *p, const char *end, int64_t *out)
+{
+    int64_t whole = 0;
+    int digits = 0;
+
+    p = skip_blanks(p, end);
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (whole < 100000000) {
+            whole = whole * 10 + (*p - '0');
+        }
+        p++;
+        digits++;
+    }
+
+    int tenths = 0;
+    int round_up = 0;
+    if (p < end && *p == '.') {
+        p++;
+        if (p < end && *p >= '0' && *p <= '9') {
+            tenths = *p++ - '0';
+            digits++;
+        }
+        if (p < end && *p >= '0' && *p <= '9') {
+            round_up = (*p++ - '0') >= 5;
+        }
+        while (p < end && *p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    if (digits == 0) {
+        return NULL;
+    }
+    *out = whole * 10 + tenths + round_up;
+    return p;
+}
+
+static const char *expect_separator(const char *p, const char *end)
+{
+    p = skip_blanks(p, end);
+    return (p < end && *p == ';') ? p + 1 : NULL;
+}
+
+static void parse_line(parsed_chunk_t *c, const char *p, const char *eol)
+{
+    while (eol > p && (eol[-1] == '\r' || eol[-1] == ' ' || eol[-1] == '\t')) {
+        eol--;
+    }
+    if (eol == p) {
+        return;
+    }
+    c->lines++;
+
+    int64_t user, item, category, rating, timestamp = 0;
+    if (!(p = parse_int(p, eol, &user)) || !(p = expect_separator(p, eol)) ||
+        !(p = parse_int(p, eol, &item)) || !(p = expect_separator(p, eol)) ||
+        !(p = parse_int(p, eol, &category)) || !(p = expect_separator(p, eol)) ||
+        !(p = parse_tenths(p, eol, &rating))) {
+        c->rejected++;
+        return;
+    }
+
+    // Timestamp optionnel ; sa partie décimale éventuelle est ignorée
+    p = skip_blanks(p, eol);
+    if (p < eol) {
+        if (!(p = expect_separator(p, eol)) || !(p = parse_int(p, eol, &timestamp))) {
+            c->rejected++;
+            return;
+        }
+        if (p < eol && *p == '.') {
+            do {
+                p++;
+            } while (p < eol && *p >= '0' && *p <= '9');
+        }
+        p = skip_blanks(p, eol);
+        if (p != eol) {
+            c->rejected++;
+            return;
+        }
+    }
+
+    if (user < 0 || item < 0 || rating > 50) {
+        c->rejected++;
+        return;
+    }
+
+    if (chunk_reserve(c) != 0) {
+        c->failed = 1;
+        return;
+    }
+    c->user[c->len] = (uint64_t)user;
+    c->item[c->len] = (uint64_t)item;
+    c->category[c->len] = (uint32_t)category;
+    c->rating[c->len] = (uint8_t)rating;
+    c->timestamp[c->len] = timestamp <= 0 ? 0 : timestamp >= UINT32_MAX ? UINT32_MAX : (uint32_t)timestamp;
+    c->len++;
+}
+
+static void *parse_chunk(void *arg)
+{
+    parsed_chunk_t *c = arg;
+    const char *p = c->begin;
+
+    while (p < c->end && !c->failed) {
+        const char *eol = memchr(p, '\n', c->end - p);
+        if (eol == NULL) {
+            eol = c->end;
+        }
+        parse_line(c, p, eol);
+        p = eol + 1;
+    }
+    return NULL;
+}
+
+// Ajoute les ratings analysés au journal, dans l'ordre du fichier
+static int merge_chunk(const parsed_chunk_t *c, id_map_t *users, id_map_t *items, rating_log_t *log)
+{
+    for (size_t i = 0; i < c->len; i++) {
+        uint32_t user = id_map_intern(users, c->user[i]);
+        uint32_t item = id_map_intern(items, c->item[i]);
+        if (user == ID_MAP_NONE || item == ID_MAP_NONE ||
+            rating_log_append(log, user, item, c->category[i], c->rating[i], c->timestamp[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int ingest_ratings_file(const char *path, int num_threads, id_map_t *users, id_map_t *items,
+                        rating_log_t *log, ingest_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open %s\n", path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    size_t length = (size_t)st.st_size;
+    if (length == 0) {
+        close(fd);
+        return 0;
+    }
+
+    const char *base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map ratings file");
+        return -1;
+    }
+    madvise((void *)base, length, MADV_SEQUENTIAL);
+
+    // Un thread par coeur, sans descendre sous INGEST_MIN_CHUNK octets par thread
+    if (num_threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cores > 0 ? (int)cores : 1;
+    }
+    size_t max_threads = length / INGEST_MIN_CHUNK + 1;
+    size_t n = (size_t)num_threads < max_threads ? (size_t)num_threads : max_threads;
+
+    parsed_chunk_t *chunks = calloc(n, sizeof(parsed_chunk_t));
+    pthread_t *threads = calloc(n, sizeof(pthread_t));
+    int *started = calloc(n, sizeof(int));
+    if (chunks == NULL || threads == NULL || started == NULL) {
+        free(chunks);
+        free(threads);
+        free(started);
+        munmap((void *)base, length);
+        return -1;
+    }
+
+    // Découpage aux fins de ligne : chaque ligne appartient à un seul chunk
+    const char *end = base + length;
+    const char *begin = base;
+    for (size_t t = 0; t < n; t++) {
+        const char *limit = (t + 1 == n) ? end : base + length / n * (t + 1);
+        if (limit < begin) {
+            limit = begin;
+        }
+        if (limit < end) {
+            const char *eol = memchr(limit, '\n', end - limit);
+            limit = eol ? eol + 1 : end;
+        }
+        chunks[t].begin = begin;
+        chunks[t].end = limit;
+        begin = limit;
+    }
+
+    for (size_t t = 1; t < n; t++) {
+        started[t] = pthread_create(&threads[t], NULL, parse_chunk, &chunks[t]) == 0;
+    }
+    parse_chunk(&chunks[0]);
+    for (size_t t = 1; t < n; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        } else {
+            parse_chunk(&chunks[t]);
+        }
+    }
+
+    int rc = 0;
+    for (size_t t = 0; t < n; t++) {
+        stats->lines += chunks[t].lines;
+        stats->rejected += chunks[t].rejected;
+        if (chunks[t].failed) {
+            rc = -1;
+        }
+    }
+
+    // Fusion séquentielle : l'attribution des index denses suit l'ordre du fichier
+    for (size_t t = 0; t < n && rc == 0; t++) {
+        if (merge_chunk(&chunks[t], users, items, log) != 0) {
+            rc = -1;
+            break;
+        }
+        stats->loaded += chunks[t].len;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "Error: Out of memory while loading %s\n", path);
+    }
+
+    for (size_t t = 0; t < n; t++) {
+        chunk_free(&chunks[t]);
+    }
+    free(chunks);
+    free(threads);
+    free(started);
+    munmap((void *)base, length);
+    return rc;
+}
@@ -0,0 +1,30 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stddef.h>
+
+#include "id_map.h"
+#include "rating_log.h"
+
+// Taille minimale d'un chunk par thread : en dessous, le coût de création
+// des threads dépasse le gain
+#define INGEST_MIN_CHUNK (1 << 20)
+
+// Compteurs d'un chargement
+typedef struct IngestStats {
+    size_t lines;        // lignes non vides
+    size_t loaded;       // ratings ajoutés au journal
+    size_t rejected;     // lignes mal formées ou hors bornes
+} ingest_stats_t;
+
+// Charge un fichier "user;item;category;rating;timestamp" (timestamp optionnel).
+// Le fichier est projeté en mémoire et découpé en chunks alignés sur les fins
+// de ligne, analysés en parallèle par num_threads threads (0 = nombre de
+// coeurs). Les résultats sont ensuite fusionnés dans l'ordre du fichier :
+// les identifiants sont ajoutés à users/items et les ratings à log.
+// Une ligne est rejetée si un identifiant est négatif ou si la note sort de [0, 5].
+// Retourne 0 en cas de succès, -1 sinon.
+extern int ingest_ratings_file(const char *path, int num_threads, id_map_t *users, id_map_t *items,
+                               rating_log_t *log, ingest_stats_t *stats);
+
+#endif // INGEST_H
@@ -0,0 +1,499 @@
+#include <pthread.h>
+
+#include "kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// Table des implémentations d'un jeu d'instructions
+typedef struct KernelOps {
+    double (*dot)(const double *x, const double *y, size_t n);
+    float (*dot_f32)(const float *x, const float *y, size_t n);
+    void (*axpy)(double a, const double *x, double *y, size_t n);
+    void (*axpby)(double a, const double *x, double b, double *y, size_t n);
+    void (*masked_stats)(const double *x, const double *y, size_t n, double threshold,
+                         kernel_stats_t *stats);
+} kernel_ops_t;
+
+// ========== Implémentation scalaire (référence et repli) ==========
+
+static double scalar_dot(const double *x, const double *y, size_t n)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+static float scalar_dot_f32(const float *x, const float *y, size_t n)
+{
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+static void scalar_axpy(double a, const double *x, double *y, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+static void scalar_axpby(double a, const double *x, double b, double *y, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        y[i] = a * x[i] + b * y[i];
+    }
+}
+
+// Ajoute à stats les positions [from, n) ; sert aussi de fin de boucle
+// aux versions vectorielles
+static void scalar_stats_tail(const double *x, const double *y, size_t from, size_t n, double threshold,
+                              kernel_stats_t *stats)
+{
+    for (size_t i = from; i < n; i++) {
+        if (x[i] > threshold && y[i] > threshold) {
+            stats->count++;
+            stats->sum_x += x[i];
+            stats->sum_y += y[i];
+            stats->sum_xx += x[i] * x[i];
+            stats->sum_yy += y[i] * y[i];
+            stats->sum_xy += x[i] * y[i];
+        }
+    }
+}
+
+static void scalar_masked_stats(const double *x, const double *y, size_t n, double threshold,
+                                kernel_stats_t *stats)
+{
+    stats->count = 0;
+    stats->sum_x = stats->sum_y = stats->sum_xx = stats->sum_yy = stats->sum_xy = 0.0;
+    scalar_stats_tail(x, y, 0, n, threshold, stats);
+}
+
+#ifdef KERNELS_X86
+
+// ========== SSE2 (2 doubles) ==========
+
+__attribute__((target("sse2")))
+static double sse2_hsum(__m128d v)
+{
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+__attribute__((target("sse2")))
+static double sse2_dot(const double *x, const double *y, size_t n)
+{
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    double sum = sse2_hsum(_mm_add_pd(acc0, acc1));
+    for (; i < n; i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+__attribute__((target("sse2")))
+static float sse2_dot_f32(const float *x, const float *y, size_t n)
+{
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(y + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    float sum = _mm_cvtss_f32(acc);
+    for (; i < n; i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+__attribute__((target("sse2")))
+static void sse2_axpy(double a, const double *x, double *y, size_t n)
+{
+    __m128d va = _mm_set1_pd(a);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i))));
+    }
+    for (; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+__attribute__((target("sse2")))
+static void sse2_axpby(double a, const double *x, double b, double *y, size_t n)
+{
+    __m128d va = _mm_set1_pd(a), vb = _mm_set1_pd(b);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d r = _mm_add_pd(_mm_mul_pd(va, _mm_loadu_pd(x + i)), _mm_mul_pd(vb, _mm_loadu_pd(y + i)));
+        _mm_storeu_pd(y + i, r);
+    }
+    for (; i < n; i++) {
+        y[i] = a * x[i] + b * y[i];
+    }
+}
+
+__attribute__((target("sse2")))
+static void sse2_masked_stats(const double *x, const double *y, size_t n, double threshold,
+                              kernel_stats_t *stats)
+{
+    __m128d t = _mm_set1_pd(threshold);
+    __m128d sx = _mm_setzero_pd(), sy = _mm_setzero_pd();
+    __m128d sxx = _mm_setzero_pd(), syy = _mm_setzero_pd(), sxy = _mm_setzero_pd();
+    size_t count = 0, i = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        __m128d vx = _mm_loadu_pd(x + i);
+        __m128d vy = _mm_loadu_pd(y + i);
+        __m128d mask = _mm_and_pd(_mm_cmpgt_pd(vx, t), _mm_cmpgt_pd(vy, t));
+        vx = _mm_and_pd(vx, mask);
+        vy = _mm_and_pd(vy, mask);
+        sx = _mm_add_pd(sx, vx);
+        sy = _mm_add_pd(sy, vy);
+        sxx = _mm_add_pd(sxx, _mm_mul_pd(vx, vx));
+        syy = _mm_add_pd(syy, _mm_mul_pd(vy, vy));
+        sxy = _mm_add_pd(sxy, _mm_mul_pd(vx, vy));
+        count += __builtin_popcount(_mm_movemask_pd(mask));
+    }
+
+    stats->count = count;
+    stats->sum_x = sse2_hsum(sx);
+    stats->sum_y = sse2_hsum(sy);
+    stats->sum_xx = sse2_hsum(sxx);
+    stats->sum_yy = sse2_hsum(syy);
+    stats->sum_xy = sse2_hsum(sxy);
+    scalar_stats_tail(x, y, i, n, threshold, stats);
+}
+
+// ========== AVX2 + FMA (4 doubles) ==========
+
+__attribute__((target("avx2,fma")))
+static double avx2_hsum(__m256d v)
+{
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+__attribute__((target("avx2,fma")))
+static double avx2_dot(const double *x, const double *y, size_t n)
+{
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), acc1);
+    }
+    if (i + 4 <= n) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), acc0);
+        i += 4;
+    }
+    double sum = avx2_hsum(_mm256_add_pd(acc0, acc1));
+    for (; i < n; i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static float avx2_dot_f32(const float *x, const float *y, size_t n)
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), acc1);
+    }
+    if (i + 8 <= n) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), acc0);
+        i += 8;
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    float sum = _mm_cvtss_f32(s);
+    for (; i < n; i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_axpy(double a, const double *x, double *y, size_t n)
+{
+    __m256d va = _mm256_set1_pd(a);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    for (; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_axpby(double a, const double *x, double b, double *y, size_t n)
+{
+    __m256d va = _mm256_set1_pd(a), vb = _mm256_set1_pd(b);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d by = _mm256_mul_pd(vb, _mm256_loadu_pd(y + i));
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), by));
+    }
+    for (; i < n; i++) {
+        y[i] = a * x[i] + b * y[i];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void avx2_masked_stats(const double *x, const double *y, size_t n, double threshold,
+                              kernel_stats_t *stats)
+{
+    __m256d t = _mm256_set1_pd(threshold);
+    __m256d sx = _mm256_setzero_pd(), sy = _mm256_setzero_pd();
+    __m256d sxx = _mm256_setzero_pd(), syy = _mm256_setzero_pd(), sxy = _mm256_setzero_pd();
+    size_t count = 0, i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256d vx = _mm256_loadu_pd(x + i);
+        __m256d vy = _mm256_loadu_pd(y + i);
+        __m256d mask = _mm256_and_pd(_mm256_cmp_pd(vx, t, _CMP_GT_OQ), _mm256_cmp_pd(vy, t, _CMP_GT_OQ));
+        vx = _mm256_and_pd(vx, mask);
+        vy = _mm256_and_pd(vy, mask);
+        sx = _mm256_add_pd(sx, vx);
+        sy = _mm256_add_pd(sy, vy);
+        sxx = _mm256_fmadd_pd(vx, vx, sxx);
+        syy = _mm256_fmadd_pd(vy, vy, syy);
+        sxy = _mm256_fmadd_pd(vx, vy, sxy);
+        count += __builtin_popcount(_mm256_movemask_pd(mask));
+    }
+
+    stats->count = count;
+    stats->sum_x = avx2_hsum(sx);
+    stats->sum_y = avx2_hsum(sy);
+    stats->sum_xx = avx2_hsum(sxx);
+    stats->sum_yy = avx2_hsum(syy);
+    stats->sum_xy = avx2_hsum(sxy);
+    scalar_stats_tail(x, y, i, n, threshold, stats);
+}
+
+// ========== AVX-512F (8 doubles, fin de boucle par masque) ==========
+
+__attribute__((target("avx512f")))
+static __mmask8 avx512_tail(size_t remaining)
+{
+    return remaining >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << remaining) - 1);
+}
+
+__attribute__((target("avx512f")))
+static double avx512_dot(const double *x, const double *y, size_t n)
+{
+    __m512d acc = _mm512_setzero_pd();
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = avx512_tail(n - i);
+        acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i), acc);
+    }
+    return _mm512_reduce_add_pd(acc);
+}
+
+__attribute__((target("avx512f")))
+static float avx512_dot_f32(const float *x, const float *y, size_t n)
+{
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 m = n - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - i)) - 1);
+        acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i), acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_axpy(double a, const double *x, double *y, size_t n)
+{
+    __m512d va = _mm512_set1_pd(a);
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = avx512_tail(n - i);
+        __m512d r = _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i));
+        _mm512_mask_storeu_pd(y + i, m, r);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void avx512_axpby(double a, const double *x, double b, double *y, size_t n)
+{
+    __m512d va = _mm512_set1_pd(a), vb = _mm512_set1_pd(b);
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = avx512_tail(n - i);
+        __m512d by = _mm512_mul_pd(vb, _mm512_maskz_loadu_pd(m, y + i));
+        _mm512_mask_storeu_pd(y + i, m, _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(m, x + i), by));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void avx512_masked_stats(const double *x, const double *y, size_t n, double threshold,
+                                kernel_stats_t *stats)
+{
+    __m512d t = _mm512_set1_pd(threshold);
+    __m512d sx = _mm512_setzero_pd(), sy = _mm512_setzero_pd();
+    __m512d sxx = _mm512_setzero_pd(), syy = _mm512_setzero_pd(), sxy = _mm512_setzero_pd();
+    size_t count = 0;
+
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 tail = avx512_tail(n - i);
+        __m512d vx = _mm512_maskz_loadu_pd(tail, x + i);
+        __m512d vy = _mm512_maskz_loadu_pd(tail, y + i);
+        __mmask8 m = _mm512_mask_cmp_pd_mask(tail, vx, t, _CMP_GT_OQ) & _mm512_cmp_pd_mask(vy, t, _CMP_GT_OQ);
+        vx = _mm512_maskz_mov_pd(m, vx);
+        vy = _mm512_maskz_mov_pd(m, vy);
+        sx = _mm512_add_pd(sx, vx);
+        sy = _mm512_add_pd(sy, vy);
+        sxx = _mm512_fmadd_pd(vx, vx, sxx);
+        syy = _mm512_fmadd_pd(vy, vy, syy);
+        sxy = _mm512_fmadd_pd(vx, vy, sxy);
+        count += __builtin_popcount(m);
+    }
+
+    stats->count = count;
+    stats->sum_x = _mm512_reduce_add_pd(sx);
+    stats->sum_y = _mm512_reduce_add_pd(sy);
+    stats->sum_xx = _mm512_reduce_add_pd(sxx);
+    stats->sum_yy = _mm512_reduce_add_pd(syy);
+    stats->sum_xy = _mm512_reduce_add_pd(sxy);
+}
+
+#endif // KERNELS_X86
+
+static const kernel_ops_t ops_table[KERNEL_NUM_ISA] = {
+    [KERNEL_SCALAR] = { scalar_dot, scalar_dot_f32, scalar_axpy, scalar_axpby, scalar_masked_stats },
+#ifdef KERNELS_X86
+    [KERNEL_SSE2] = { sse2_dot, sse2_dot_f32, sse2_axpy, sse2_axpby, sse2_masked_stats },
+    [KERNEL_AVX2] = { avx2_dot, avx2_dot_f32, avx2_axpy, avx2_axpby, avx2_masked_stats },
+    [KERNEL_AVX512] = { avx512_dot, avx512_dot_f32, avx512_axpy, avx512_axpby, avx512_masked_stats },
+#endif
+};
+
+static const char *isa_names[KERNEL_NUM_ISA] = { "scalar", "sse2", "avx2", "avx512" };
+
+// Implémentation courante : NULL jusqu'au premier kernels_init()
+static const kernel_ops_t *ops = NULL;
+static kernel_isa_t current_isa = KERNEL_SCALAR;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+int kernels_supported(kernel_isa_t isa)
+{
+    switch (isa) {
+    case KERNEL_SCALAR:
+        return 1;
+#ifdef KERNELS_X86
+    case KERNEL_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case KERNEL_AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return 0;
+    }
+}
+
+static int set_isa(kernel_isa_t isa)
+{
+    if (isa >= KERNEL_NUM_ISA || !kernels_supported(isa)) {
+        return -1;
+    }
+    current_isa = isa;
+    ops = &ops_table[isa];
+    return 0;
+}
+
+static void select_best(void)
+{
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+#endif
+    for (int isa = KERNEL_NUM_ISA - 1; isa > KERNEL_SCALAR; isa--) {
+        if (set_isa((kernel_isa_t)isa) == 0) {
+            return;
+        }
+    }
+    set_isa(KERNEL_SCALAR);
+}
+
+void kernels_init(void)
+{
+    pthread_once(&init_once, select_best);
+}
+
+int kernels_select(kernel_isa_t isa)
+{
+    kernels_init();
+    return set_isa(isa);
+}
+
+kernel_isa_t kernels_isa(void)
+{
+    kernels_init();
+    return current_isa;
+}
+
+const char *kernels_name(kernel_isa_t isa)
+{
+    return isa < KERNEL_NUM_ISA ? isa_names[isa] : "unknown";
+}
+
+double kernel_dot(const double *x, const double *y, size_t n)
+{
+    if (ops == NULL) {
+        kernels_init();
+    }
+    return ops->dot(x, y, n);
+}
+
+float kernel_dot_f32(const float *x, const float *y, size_t n)
+{
+    if (ops == NULL) {
+        kernels_init();
+    }
+    return ops->dot_f32(x, y, n);
+}
+
+void kernel_axpy(double a, const double *x, double *y, size_t n)
+{
+    if (ops == NULL) {
+        kernels_init();
+    }
+    ops->axpy(a, x, y, n);
+}
+
+void kernel_axpby(double a, const double *x, double b, double *y, size_t n)
+{
+    if (ops == NULL) {
+        kernels_init();
+    }
+    ops->axpby(a, x, b, y, n);
+}
+
+void kernel_masked_stats(const double *x, const double *y, size_t n, double threshold,
+                         kernel_stats_t *stats)
+{
+    if (ops == NULL) {
+        kernels_init();
+    }
+    ops->masked_stats(x, y, n, threshold, stats);
+}
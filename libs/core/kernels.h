@@ -0,0 +1,53 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+
+// Jeux d'instructions disponibles, du plus lent au plus rapide
+typedef enum {
+    KERNEL_SCALAR,
+    KERNEL_SSE2,
+    KERNEL_AVX2,     // AVX2 + FMA
+    KERNEL_AVX512,   // AVX-512F
+    KERNEL_NUM_ISA
+} kernel_isa_t;
+
+// Statistiques suffisantes de Pearson sur les positions où x et y dépassent
+// tous deux le seuil (notes présentes dans les deux lignes)
+typedef struct KernelStats {
+    size_t count;
+    double sum_x;
+    double sum_y;
+    double sum_xx;
+    double sum_yy;
+    double sum_xy;
+} kernel_stats_t;
+
+// Choisit la meilleure implémentation supportée par le processeur (CPUID).
+// Appelée automatiquement au premier appel d'un noyau ; l'appeler au
+// démarrage évite seulement ce premier détour.
+extern void kernels_init(void);
+
+// Force une implémentation (tests, mesures). Retourne -1 si le processeur
+// ne la supporte pas.
+extern int kernels_select(kernel_isa_t isa);
+extern int kernels_supported(kernel_isa_t isa);
+extern kernel_isa_t kernels_isa(void);
+extern const char *kernels_name(kernel_isa_t isa);
+
+// Noyaux denses sur des lignes contiguës de n doubles
+extern double kernel_dot(const double *x, const double *y, size_t n);
+
+// Produit scalaire en simple précision (facteurs MF compactés)
+extern float kernel_dot_f32(const float *x, const float *y, size_t n);
+
+// y += a * x
+extern void kernel_axpy(double a, const double *x, double *y, size_t n);
+
+// y = a * x + b * y
+extern void kernel_axpby(double a, const double *x, double b, double *y, size_t n);
+
+extern void kernel_masked_stats(const double *x, const double *y, size_t n, double threshold,
+                                kernel_stats_t *stats);
+
+#endif // KERNELS_H
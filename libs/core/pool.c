@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+// Pool et numéro du worker exécutant le thread courant (appels imbriqués)
+static __thread const thread_pool_t *current_pool = NULL;
+static __thread size_t current_worker = 0;
+
+typedef struct {
+    thread_pool_t *pool;
+    size_t worker;
+} worker_arg_t;
+
+// Distribue les tranches de la boucle courante jusqu'à épuisement
+static void run_chunks(thread_pool_t *pool, size_t worker)
+{
+    const thread_pool_t *previous_pool = current_pool;
+    size_t previous_worker = current_worker;
+    current_pool = pool;
+    current_worker = worker;
+
+    for (;;) {
+        size_t begin = __atomic_fetch_add(&pool->next, pool->grain, __ATOMIC_RELAXED);
+        if (begin >= pool->count) {
+            break;
+        }
+        size_t end = pool->count - begin > pool->grain ? begin + pool->grain : pool->count;
+        pool->task(pool->arg, begin, end, worker);
+    }
+
+    current_pool = previous_pool;
+    current_worker = previous_worker;
+}
+
+static void *worker_main(void *data)
+{
+    worker_arg_t *w = data;
+    thread_pool_t *pool = w->pool;
+    size_t worker = w->worker;
+    free(w);
+
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->wake, &pool->mutex);
+        }
+        if (pool->stop) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        run_chunks(pool, worker);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->running == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+int pool_init(thread_pool_t *pool, size_t num_threads)
+{
+    memset(pool, 0, sizeof(*pool));
+    if (num_threads == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cores > 0 ? (size_t)cores : 1;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_mutex_init(&pool->submit, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->num_threads = 1;
+
+    pool->threads = calloc(num_threads, sizeof(pthread_t));
+    if (pool->threads == NULL) {
+        pool_free(pool);
+        return -1;
+    }
+    for (size_t t = 1; t < num_threads; t++) {
+        worker_arg_t *w = malloc(sizeof(worker_arg_t));
+        if (w == NULL) {
+            pool_free(pool);
+            return -1;
+        }
+        w->pool = pool;
+        w->worker = t;
+        if (pthread_create(&pool->threads[t - 1], NULL, worker_main, w) != 0) {
+            free(w);
+            pool_free(pool);
+            return -1;
+        }
+        pool->num_threads++;
+    }
+    return 0;
+}
+
+void pool_free(thread_pool_t *pool)
+{
+    if (pool == NULL || pool->num_threads == 0) {
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+    for (size_t t = 0; t + 1 < pool->num_threads; t++) {
+        pthread_join(pool->threads[t], NULL);
+    }
+
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_mutex_destroy(&pool->submit);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    memset(pool, 0, sizeof(*pool));
+}
+
+size_t pool_size(const thread_pool_t *pool)
+{
+    return pool != NULL && pool->num_threads > 0 ? pool->num_threads : 1;
+}
+
+void pool_parallel_for(thread_pool_t *pool, size_t count, size_t grain, pool_task_t task, void *arg)
+{
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+
+    // Séquentiel : pas de pool, boucle trop courte pour être partagée, ou
+    // appel depuis une tâche de ce pool (ses workers sont déjà occupés)
+    if (pool == NULL || pool->num_threads <= 1 || count <= grain || current_pool == pool) {
+        size_t worker = current_pool == pool ? current_worker : 0;
+        for (size_t begin = 0; begin < count; begin += grain) {
+            task(arg, begin, count - begin > grain ? begin + grain : count, worker);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->submit);
+    pthread_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->arg = arg;
+    pool->count = count;
+    pool->grain = grain;
+    pool->next = 0;
+    pool->running = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+
+    run_chunks(pool, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->running > 0) {
+        pthread_cond_wait(&pool->done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    pthread_mutex_unlock(&pool->submit);
+}
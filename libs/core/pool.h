@@ -0,0 +1,46 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// Traite les indices [begin, end) ; worker est le numéro du thread
+// (0 .. pool_size() - 1), utilisable pour indexer des résultats partiels
+typedef void (*pool_task_t)(void *arg, size_t begin, size_t end, size_t worker);
+
+// Pool de threads persistants : les workers sont créés une fois et attendent
+// les boucles de pool_parallel_for(). Le thread appelant participe en tant
+// que worker 0.
+typedef struct ThreadPool {
+    size_t num_threads;      // appelant compris
+    pthread_t *threads;      // num_threads - 1 workers
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    pthread_mutex_t submit;  // une seule boucle à la fois
+    unsigned long generation;
+    size_t running;          // workers encore actifs sur la boucle courante
+    int stop;
+
+    // Boucle courante
+    pool_task_t task;
+    void *arg;
+    size_t count;
+    size_t grain;
+    size_t next;             // prochain indice à distribuer (atomique)
+} thread_pool_t;
+
+// num_threads = 0 : un thread par coeur. Retourne 0 ou -1.
+extern int pool_init(thread_pool_t *pool, size_t num_threads);
+extern void pool_free(thread_pool_t *pool);
+
+// Nombre de workers : dimension des tableaux de résultats partiels
+extern size_t pool_size(const thread_pool_t *pool);
+
+// Appelle task sur des tranches d'au plus grain indices couvrant [0, count),
+// distribuées dynamiquement, et retourne quand toutes sont traitées.
+// pool peut être NULL (exécution séquentielle). Un appel depuis une tâche
+// du même pool s'exécute séquentiellement dans le worker courant.
+extern void pool_parallel_for(thread_pool_t *pool, size_t count, size_t grain, pool_task_t task, void *arg);
+
+#endif // POOL_H
@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "rating_log.h"
+
+void rating_log_free(rating_log_t *log)
+{
+    if (log == NULL) {
+        return;
+    }
+    for (size_t c = 0; c < log->num_chunks; c++) {
+        free(log->chunks[c]);
+    }
+    free(log->chunks);
+    memset(log, 0, sizeof(*log));
+}
+
+int rating_log_attach(rating_log_t *log, rating_columns_t base)
+{
+    if (log->size != 0) {
+        return -1;
+    }
+    log->base = base;
+    log->size = base.len;
+    return 0;
+}
+
+int rating_log_append(rating_log_t *log, uint32_t user, uint32_t item, uint32_t category,
+                      uint8_t rating, uint32_t timestamp)
+{
+    size_t appended = log->size - log->base.len;
+    size_t offset = appended % RATING_LOG_CHUNK;
+
+    if (offset == 0 && appended / RATING_LOG_CHUNK == log->num_chunks) {
+        if (log->num_chunks == log->cap_chunks) {
+            size_t cap = log->cap_chunks ? log->cap_chunks * 2 : 16;
+            rating_chunk_t **chunks = realloc(log->chunks, cap * sizeof(rating_chunk_t *));
+            if (chunks == NULL) {
+                return -1;
+            }
+            log->chunks = chunks;
+            log->cap_chunks = cap;
+        }
+
+        rating_chunk_t *chunk = malloc(sizeof(rating_chunk_t));
+        if (chunk == NULL) {
+            return -1;
+        }
+        log->chunks[log->num_chunks++] = chunk;
+    }
+
+    rating_chunk_t *chunk = log->chunks[appended / RATING_LOG_CHUNK];
+    chunk->user[offset] = user;
+    chunk->item[offset] = item;
+    chunk->category[offset] = category;
+    chunk->timestamp[offset] = timestamp;
+    chunk->rating[offset] = rating;
+    log->size++;
+    return 0;
+}
+
+size_t rating_log_num_segments(const rating_log_t *log)
+{
+    size_t appended = log->size - log->base.len;
+    return (log->base.len > 0) + (appended + RATING_LOG_CHUNK - 1) / RATING_LOG_CHUNK;
+}
+
+rating_columns_t rating_log_segment(const rating_log_t *log, size_t segment)
+{
+    rating_columns_t columns = {0};
+
+    if (segment >= rating_log_num_segments(log)) {
+        return columns;
+    }
+    if (log->base.len > 0) {
+        if (segment == 0) {
+            return log->base;
+        }
+        segment--;
+    }
+
+    const rating_chunk_t *chunk = log->chunks[segment];
+    size_t begin = log->base.len + segment * RATING_LOG_CHUNK;
+    columns.user = chunk->user;
+    columns.item = chunk->item;
+    columns.category = chunk->category;
+    columns.timestamp = chunk->timestamp;
+    columns.rating = chunk->rating;
+    columns.len = (log->size - begin < RATING_LOG_CHUNK) ? log->size - begin : RATING_LOG_CHUNK;
+    return columns;
+}
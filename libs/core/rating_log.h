@@ -0,0 +1,54 @@
+#ifndef RATING_LOG_H
+#define RATING_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Nombre d'entrées par chunk (~1.1 Mo par chunk)
+#define RATING_LOG_CHUNK 65536
+
+// Chunk du journal en colonnes (structure of arrays)
+typedef struct RatingChunk {
+    uint32_t user[RATING_LOG_CHUNK];       // index dense
+    uint32_t item[RATING_LOG_CHUNK];       // index dense
+    uint32_t category[RATING_LOG_CHUNK];
+    uint32_t timestamp[RATING_LOG_CHUNK];  // secondes depuis l'epoch
+    uint8_t rating[RATING_LOG_CHUNK];      // note x10 (0-50)
+} rating_chunk_t;
+
+// Vue en colonnes d'un segment contigu du journal
+typedef struct RatingColumns {
+    const uint32_t *user;
+    const uint32_t *item;
+    const uint32_t *category;
+    const uint32_t *timestamp;
+    const uint8_t *rating;
+    size_t len;
+} rating_columns_t;
+
+// Journal des notes, en ajout seul. Les chunks ne sont jamais déplacés ni
+// copiés : seul le tableau de pointeurs grandit. Une structure mise à zéro
+// est un journal vide valide. Le journal peut commencer par un segment de
+// base emprunté (colonnes d'un snapshot mmap), suivi des chunks ajoutés.
+typedef struct RatingLog {
+    rating_columns_t base;
+    rating_chunk_t **chunks;
+    size_t num_chunks;
+    size_t cap_chunks;
+    size_t size;
+} rating_log_t;
+
+extern void rating_log_free(rating_log_t *log);
+
+// Utilise des colonnes existantes (non copiées) comme début d'un journal vide
+extern int rating_log_attach(rating_log_t *log, rating_columns_t base);
+
+// Retourne 0 en cas de succès, -1 en cas d'échec d'allocation
+extern int rating_log_append(rating_log_t *log, uint32_t user, uint32_t item, uint32_t category,
+                             uint8_t rating, uint32_t timestamp);
+
+// Parcours en colonnes : for (s = 0; s < rating_log_num_segments(log); s++) rating_log_segment(log, s)
+extern size_t rating_log_num_segments(const rating_log_t *log);
+extern rating_columns_t rating_log_segment(const rating_log_t *log, size_t segment);
+
+#endif // RATING_LOG_H
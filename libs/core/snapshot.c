@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+#include "dataset.h"
+
+static uint64_t align_up(uint64_t x)
+{
+    return (x + SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SNAPSHOT_ALIGN - 1);
+}
+
+// Calcule la taille et la position de chaque section à partir des compteurs de l'en-tête
+static void layout(snapshot_header_t *h)
+{
+    uint64_t *size = h->section_size;
+
+    size[SNAP_USER_KEYS] = h->user_capacity * sizeof(uint64_t);
+    size[SNAP_USER_SLOTS] = h->user_capacity * sizeof(uint32_t);
+    size[SNAP_USER_EXTERNAL] = h->num_users * sizeof(uint64_t);
+    size[SNAP_ITEM_KEYS] = h->item_capacity * sizeof(uint64_t);
+    size[SNAP_ITEM_SLOTS] = h->item_capacity * sizeof(uint32_t);
+    size[SNAP_ITEM_EXTERNAL] = h->num_items * sizeof(uint64_t);
+    size[SNAP_LOG_USER] = h->num_ratings * sizeof(uint32_t);
+    size[SNAP_LOG_ITEM] = h->num_ratings * sizeof(uint32_t);
+    size[SNAP_LOG_CATEGORY] = h->num_ratings * sizeof(uint32_t);
+    size[SNAP_LOG_TIMESTAMP] = h->num_ratings * sizeof(uint32_t);
+    size[SNAP_LOG_RATING] = h->num_ratings * sizeof(uint8_t);
+    size[SNAP_CSR_OFFSETS] = (h->num_users + 1) * sizeof(uint64_t);
+    size[SNAP_CSR_INDEX] = h->nnz * sizeof(uint32_t);
+    size[SNAP_CSR_VALUE] = h->nnz * sizeof(uint8_t);
+    size[SNAP_CSC_OFFSETS] = (h->num_items + 1) * sizeof(uint64_t);
+    size[SNAP_CSC_INDEX] = h->nnz * sizeof(uint32_t);
+    size[SNAP_CSC_VALUE] = h->nnz * sizeof(uint8_t);
+
+    uint64_t pos = align_up(sizeof(snapshot_header_t));
+    for (int s = 0; s < SNAP_NUM_SECTIONS; s++) {
+        h->section_offset[s] = pos;
+        pos = align_up(pos + size[s]);
+    }
+    h->file_size = pos;
+}
+
+static int write_at(FILE *f, uint64_t offset, const void *data, size_t size)
+{
+    static const char zeros[SNAPSHOT_ALIGN];
+
+    long pos = ftell(f);
+    if (pos < 0 || (uint64_t)pos > offset) {
+        return -1;
+    }
+    while ((uint64_t)pos < offset) {
+        size_t pad = offset - pos < sizeof(zeros) ? offset - pos : sizeof(zeros);
+        if (fwrite(zeros, 1, pad, f) != pad) {
+            return -1;
+        }
+        pos += pad;
+    }
+    if (size > 0 && fwrite(data, 1, size, f) != size) {
+        return -1;
+    }
+    return 0;
+}
+
+// Écrit une colonne du journal, segment par segment
+static int write_log_column(FILE *f, uint64_t offset, const rating_log_t *log, snapshot_section_t section)
+{
+    if (write_at(f, offset, NULL, 0) != 0) {
+        return -1;
+    }
+
+    for (size_t s = 0; s < rating_log_num_segments(log); s++) {
+        rating_columns_t col = rating_log_segment(log, s);
+        const void *data = NULL;
+        size_t width = sizeof(uint32_t);
+
+        switch (section) {
+            case SNAP_LOG_USER:      data = col.user; break;
+            case SNAP_LOG_ITEM:      data = col.item; break;
+            case SNAP_LOG_CATEGORY:  data = col.category; break;
+            case SNAP_LOG_TIMESTAMP: data = col.timestamp; break;
+            case SNAP_LOG_RATING:    data = col.rating; width = sizeof(uint8_t); break;
+            default: return -1;
+        }
+
+        if (col.len > 0 && fwrite(data, width, col.len, f) != col.len) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int snapshot_write(const char *path, const id_map_t *users, const id_map_t *items,
+                   const rating_log_t *log, const rating_store_t *store)
+{
+    if (store->num_users != users->size || store->num_items != items->size) {
+        fprintf(stderr, "Error: Rating store does not match the ID dictionaries\n");
+        return -1;
+    }
+
+    snapshot_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    h.version = SNAPSHOT_VERSION;
+    h.header_size = sizeof(snapshot_header_t);
+    h.num_users = users->size;
+    h.num_items = items->size;
+    h.num_ratings = log->size;
+    h.nnz = store->nnz;
+    h.user_capacity = users->capacity;
+    h.item_capacity = items->capacity;
+    h.fingerprint = dataset_fingerprint(users, items, log);
+    layout(&h);
+
+    // Écriture dans un fichier temporaire puis renommage : un serveur qui
+    // démarre ne voit jamais de snapshot à moitié écrit
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        return -1;
+    }
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        perror("Failed to create snapshot");
+        return -1;
+    }
+
+    const uint64_t *off = h.section_offset;
+    const uint64_t *size = h.section_size;
+    int rc = 0;
+    rc |= write_at(f, 0, &h, sizeof(h));
+    rc |= write_at(f, off[SNAP_USER_KEYS], users->keys, size[SNAP_USER_KEYS]);
+    rc |= write_at(f, off[SNAP_USER_SLOTS], users->slots, size[SNAP_USER_SLOTS]);
+    rc |= write_at(f, off[SNAP_USER_EXTERNAL], users->external, size[SNAP_USER_EXTERNAL]);
+    rc |= write_at(f, off[SNAP_ITEM_KEYS], items->keys, size[SNAP_ITEM_KEYS]);
+    rc |= write_at(f, off[SNAP_ITEM_SLOTS], items->slots, size[SNAP_ITEM_SLOTS]);
+    rc |= write_at(f, off[SNAP_ITEM_EXTERNAL], items->external, size[SNAP_ITEM_EXTERNAL]);
+    for (int s = SNAP_LOG_USER; s <= SNAP_LOG_RATING && rc == 0; s++) {
+        rc |= write_log_column(f, off[s], log, (snapshot_section_t)s);
+    }
+    rc |= write_at(f, off[SNAP_CSR_OFFSETS], store->by_user.offsets, size[SNAP_CSR_OFFSETS]);
+    rc |= write_at(f, off[SNAP_CSR_INDEX], store->by_user.index, size[SNAP_CSR_INDEX]);
+    rc |= write_at(f, off[SNAP_CSR_VALUE], store->by_user.value, size[SNAP_CSR_VALUE]);
+    rc |= write_at(f, off[SNAP_CSC_OFFSETS], store->by_item.offsets, size[SNAP_CSC_OFFSETS]);
+    rc |= write_at(f, off[SNAP_CSC_INDEX], store->by_item.index, size[SNAP_CSC_INDEX]);
+    rc |= write_at(f, off[SNAP_CSC_VALUE], store->by_item.value, size[SNAP_CSC_VALUE]);
+    rc |= write_at(f, h.file_size, NULL, 0);
+
+    if (fclose(f) != 0) {
+        rc = -1;
+    }
+    if (rc != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Error: Failed to write snapshot %s\n", path);
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+static int is_power_of_two(uint64_t x)
+{
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+// Vérifie que l'en-tête décrit exactement le fichier projeté
+static int validate_header(const snapshot_header_t *h, size_t length)
+{
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        fprintf(stderr, "Error: Not a rating snapshot\n");
+        return -1;
+    }
+    if (h->version != SNAPSHOT_VERSION || h->header_size != sizeof(snapshot_header_t)) {
+        fprintf(stderr, "Error: Unsupported snapshot version %u\n", h->version);
+        return -1;
+    }
+    // Chaque section tient dans le fichier : les produits calculés par
+    // layout() ne peuvent pas déborder
+    if (h->user_capacity > length / sizeof(uint64_t) || h->item_capacity > length / sizeof(uint64_t) ||
+        h->num_users > length / sizeof(uint64_t) || h->num_items > length / sizeof(uint64_t) ||
+        h->num_ratings > length / sizeof(uint32_t) || h->nnz > length / sizeof(uint32_t)) {
+        fprintf(stderr, "Error: Snapshot layout does not match its header\n");
+        return -1;
+    }
+    if ((h->user_capacity && !is_power_of_two(h->user_capacity)) ||
+        (h->item_capacity && !is_power_of_two(h->item_capacity)) ||
+        h->num_users * 2 > h->user_capacity + (h->num_users == 0) ||
+        h->num_items * 2 > h->item_capacity + (h->num_items == 0) ||
+        h->nnz > h->num_ratings) {
+        fprintf(stderr, "Error: Corrupted snapshot header\n");
+        return -1;
+    }
+
+    snapshot_header_t expected = *h;
+    layout(&expected);
+    if (h->file_size != length || expected.file_size != length ||
+        memcmp(expected.section_offset, h->section_offset, sizeof(h->section_offset)) != 0 ||
+        memcmp(expected.section_size, h->section_size, sizeof(h->section_size)) != 0) {
+        fprintf(stderr, "Error: Snapshot layout does not match its header\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Offsets CSR/CSC : de 0 à nnz sans jamais décroître
+static int check_offsets(const uint64_t *offsets, uint64_t rows, uint64_t nnz)
+{
+    if (offsets[0] != 0 || offsets[rows] != nnz) {
+        return -1;
+    }
+    for (uint64_t r = 0; r < rows; r++) {
+        if (offsets[r] > offsets[r + 1]) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_below(const uint32_t *ids, uint64_t n, uint64_t bound)
+{
+    for (uint64_t i = 0; i < n; i++) {
+        if (ids[i] >= bound) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Cases du dictionnaire : vides ou index dense valide, exactement size
+// occupées (il reste des cases vides, qui arrêtent le sondage)
+static int check_slots(const uint32_t *slots, uint64_t capacity, uint64_t size)
+{
+    uint64_t used = 0;
+    for (uint64_t i = 0; i < capacity; i++) {
+        if (slots[i] == ID_MAP_NONE) {
+            continue;
+        }
+        if (slots[i] >= size) {
+            return -1;
+        }
+        used++;
+    }
+    return used == size ? 0 : -1;
+}
+
+// Offsets des vues : O(users + items), vérifiés à chaque ouverture
+static int validate_offsets(const snapshot_header_t *h, const char *bytes)
+{
+    const uint64_t *off = h->section_offset;
+    if (check_offsets((const uint64_t *)(bytes + off[SNAP_CSR_OFFSETS]), h->num_users, h->nnz) != 0 ||
+        check_offsets((const uint64_t *)(bytes + off[SNAP_CSC_OFFSETS]), h->num_items, h->nnz) != 0) {
+        fprintf(stderr, "Error: Snapshot CSR/CSC offsets are inconsistent\n");
+        return -1;
+    }
+    return 0;
+}
+
+int snapshot_verify(const snapshot_t *snap)
+{
+    const snapshot_header_t *h = snap->base;
+    const char *bytes = snap->base;
+    const uint64_t *off = h->section_offset;
+    if (check_slots((const uint32_t *)(bytes + off[SNAP_USER_SLOTS]), h->user_capacity, h->num_users) != 0 ||
+        check_slots((const uint32_t *)(bytes + off[SNAP_ITEM_SLOTS]), h->item_capacity, h->num_items) != 0) {
+        fprintf(stderr, "Error: Snapshot ID dictionaries are inconsistent\n");
+        return -1;
+    }
+    if (check_below((const uint32_t *)(bytes + off[SNAP_LOG_USER]), h->num_ratings, h->num_users) != 0 ||
+        check_below((const uint32_t *)(bytes + off[SNAP_LOG_ITEM]), h->num_ratings, h->num_items) != 0) {
+        fprintf(stderr, "Error: Snapshot rating log references unknown users or items\n");
+        return -1;
+    }
+    if (check_below((const uint32_t *)(bytes + off[SNAP_CSR_INDEX]), h->nnz, h->num_items) != 0 ||
+        check_below((const uint32_t *)(bytes + off[SNAP_CSC_INDEX]), h->nnz, h->num_users) != 0) {
+        fprintf(stderr, "Error: Snapshot CSR/CSC views are inconsistent\n");
+        return -1;
+    }
+    return 0;
+}
+
+int snapshot_open(const char *path, snapshot_t *snap, id_map_t *users, id_map_t *items,
+                  rating_log_t *log, rating_store_t *store)
+{
+    memset(snap, 0, sizeof(*snap));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(snapshot_header_t)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t length = (size_t)st.st_size;
+    void *base = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map snapshot");
+        return -1;
+    }
+
+    const snapshot_header_t *h = base;
+    if (validate_header(h, length) != 0) {
+        munmap(base, length);
+        return -1;
+    }
+
+    char *bytes = base;
+    const uint64_t *off = h->section_offset;
+    const uint64_t *csr_offsets = (const uint64_t *)(bytes + off[SNAP_CSR_OFFSETS]);
+    const uint64_t *csc_offsets = (const uint64_t *)(bytes + off[SNAP_CSC_OFFSETS]);
+    if (validate_offsets(h, bytes) != 0) {
+        munmap(base, length);
+        return -1;
+    }
+
+    // Dictionnaires : les tables de hachage sont utilisées telles quelles
+    memset(users, 0, sizeof(*users));
+    users->keys = (uint64_t *)(bytes + off[SNAP_USER_KEYS]);
+    users->slots = (uint32_t *)(bytes + off[SNAP_USER_SLOTS]);
+    users->capacity = h->user_capacity;
+    users->external = (uint64_t *)(bytes + off[SNAP_USER_EXTERNAL]);
+    users->size = h->num_users;
+    users->cap_external = h->num_users;
+    users->borrowed = 1;
+
+    memset(items, 0, sizeof(*items));
+    items->keys = (uint64_t *)(bytes + off[SNAP_ITEM_KEYS]);
+    items->slots = (uint32_t *)(bytes + off[SNAP_ITEM_SLOTS]);
+    items->capacity = h->item_capacity;
+    items->external = (uint64_t *)(bytes + off[SNAP_ITEM_EXTERNAL]);
+    items->size = h->num_items;
+    items->cap_external = h->num_items;
+    items->borrowed = 1;
+
+    // Journal : les colonnes deviennent le segment de base
+    rating_columns_t columns;
+    columns.user = (const uint32_t *)(bytes + off[SNAP_LOG_USER]);
+    columns.item = (const uint32_t *)(bytes + off[SNAP_LOG_ITEM]);
+    columns.category = (const uint32_t *)(bytes + off[SNAP_LOG_CATEGORY]);
+    columns.timestamp = (const uint32_t *)(bytes + off[SNAP_LOG_TIMESTAMP]);
+    columns.rating = (const uint8_t *)(bytes + off[SNAP_LOG_RATING]);
+    columns.len = h->num_ratings;
+    memset(log, 0, sizeof(*log));
+    rating_log_attach(log, columns);
+
+    // Vues CSR/CSC précalculées
+    memset(store, 0, sizeof(*store));
+    store->num_users = h->num_users;
+    store->num_items = h->num_items;
+    store->nnz = h->nnz;
+    store->by_user.n_rows = h->num_users;
+    store->by_user.n_cols = h->num_items;
+    store->by_user.nnz = h->nnz;
+    store->by_user.offsets = (uint64_t *)csr_offsets;
+    store->by_user.index = (uint32_t *)(bytes + off[SNAP_CSR_INDEX]);
+    store->by_user.value = (uint8_t *)(bytes + off[SNAP_CSR_VALUE]);
+    store->by_item.n_rows = h->num_items;
+    store->by_item.n_cols = h->num_users;
+    store->by_item.nnz = h->nnz;
+    store->by_item.offsets = (uint64_t *)csc_offsets;
+    store->by_item.index = (uint32_t *)(bytes + off[SNAP_CSC_INDEX]);
+    store->by_item.value = (uint8_t *)(bytes + off[SNAP_CSC_VALUE]);
+    store->borrowed = 1;
+
+    snap->base = base;
+    snap->length = length;
+    snap->fingerprint = h->fingerprint;
+    return 0;
+}
+
+void snapshot_close(snapshot_t *snap)
+{
+    if (snap == NULL || snap->base == NULL) {
+        return;
+    }
+    munmap(snap->base, snap->length);
+    memset(snap, 0, sizeof(*snap));
+}
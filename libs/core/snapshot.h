@@ -0,0 +1,80 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "id_map.h"
+#include "rating_log.h"
+#include "store.h"
+
+#define SNAPSHOT_MAGIC "RECSNAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ALIGN 64
+
+// Sections du fichier, dans l'ordre où elles sont écrites
+typedef enum {
+    SNAP_USER_KEYS,        // uint64 x user_capacity  (table d'adressage ouvert)
+    SNAP_USER_SLOTS,       // uint32 x user_capacity
+    SNAP_USER_EXTERNAL,    // uint64 x num_users
+    SNAP_ITEM_KEYS,
+    SNAP_ITEM_SLOTS,
+    SNAP_ITEM_EXTERNAL,
+    SNAP_LOG_USER,         // uint32 x num_ratings
+    SNAP_LOG_ITEM,
+    SNAP_LOG_CATEGORY,
+    SNAP_LOG_TIMESTAMP,
+    SNAP_LOG_RATING,       // uint8 x num_ratings
+    SNAP_CSR_OFFSETS,      // uint64 x (num_users + 1)
+    SNAP_CSR_INDEX,        // uint32 x nnz
+    SNAP_CSR_VALUE,        // uint8 x nnz
+    SNAP_CSC_OFFSETS,      // uint64 x (num_items + 1)
+    SNAP_CSC_INDEX,
+    SNAP_CSC_VALUE,
+    SNAP_NUM_SECTIONS
+} snapshot_section_t;
+
+// En-tête du fichier. Chaque section commence sur SNAPSHOT_ALIGN octets,
+// ce qui permet d'utiliser les tableaux directement depuis le mmap.
+typedef struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+    uint64_t num_users;
+    uint64_t num_items;
+    uint64_t num_ratings;
+    uint64_t nnz;
+    uint64_t user_capacity;
+    uint64_t item_capacity;
+    uint64_t fingerprint;    // dataset_fingerprint() calculée à l'écriture
+    uint64_t section_offset[SNAP_NUM_SECTIONS];
+    uint64_t section_size[SNAP_NUM_SECTIONS];
+} snapshot_header_t;
+
+// Fichier projeté en mémoire (lecture seule)
+typedef struct Snapshot {
+    void *base;
+    size_t length;
+    uint64_t fingerprint;    // lue dans l'en-tête, sans parcourir les données
+} snapshot_t;
+
+// Écrit un snapshot complet. store doit avoir été construit à partir de log.
+// Retourne 0 en cas de succès, -1 sinon.
+extern int snapshot_write(const char *path, const id_map_t *users, const id_map_t *items,
+                          const rating_log_t *log, const rating_store_t *store);
+
+// Projette le fichier en mémoire et fait pointer users, items, log et store
+// directement dans la projection (aucune copie). Ils restent valides jusqu'à
+// snapshot_close(). Retourne 0 en cas de succès, -1 sinon.
+extern int snapshot_open(const char *path, snapshot_t *snap, id_map_t *users, id_map_t *items,
+                         rating_log_t *log, rating_store_t *store);
+extern void snapshot_close(snapshot_t *snap);
+
+// snapshot_open() ne vérifie que l'en-tête et les offsets CSR/CSC. Parcourt
+// en plus les dictionnaires, le journal et les index des vues (O(taille du
+// fichier)) : chaque index doit être dans les bornes de la section qu'il
+// désigne. Retourne 0 si le snapshot est cohérent, -1 sinon.
+extern int snapshot_verify(const snapshot_t *snap);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "store.h"
+
+static void free_view(sparse_view_t *view)
+{
+    free(view->offsets);
+    free(view->index);
+    free(view->value);
+    memset(view, 0, sizeof(*view));
+}
+
+static int alloc_view(sparse_view_t *view, size_t n_rows, size_t n_cols, size_t nnz)
+{
+    view->n_rows = n_rows;
+    view->n_cols = n_cols;
+    view->nnz = nnz;
+    view->offsets = calloc(n_rows + 1, sizeof(uint64_t));
+    view->index = malloc((nnz ? nnz : 1) * sizeof(uint32_t));
+    view->value = malloc((nnz ? nnz : 1) * sizeof(uint8_t));
+
+    if (!view->offsets || !view->index || !view->value) {
+        free_view(view);
+        return -1;
+    }
+    return 0;
+}
+
+// Construit la vue transposée (CSR -> CSC). Le parcours des lignes dans l'ordre
+// garantit que les indices restent triés dans chaque ligne de la transposée.
+static int transpose_view(const sparse_view_t *src, sparse_view_t *dst)
+{
+    if (alloc_view(dst, src->n_cols, src->n_rows, src->nnz) != 0) {
+        return -1;
+    }
+
+    uint64_t *cursor = malloc((dst->n_rows ? dst->n_rows : 1) * sizeof(uint64_t));
+    if (!cursor) {
+        free_view(dst);
+        return -1;
+    }
+
+    for (size_t e = 0; e < src->nnz; e++) {
+        dst->offsets[src->index[e] + 1]++;
+    }
+    for (size_t r = 0; r < dst->n_rows; r++) {
+        dst->offsets[r + 1] += dst->offsets[r];
+        cursor[r] = dst->offsets[r];
+    }
+
+    for (size_t r = 0; r < src->n_rows; r++) {
+        for (uint64_t e = src->offsets[r]; e < src->offsets[r + 1]; e++) {
+            uint64_t pos = cursor[src->index[e]]++;
+            dst->index[pos] = (uint32_t)r;
+            dst->value[pos] = src->value[e];
+        }
+    }
+
+    free(cursor);
+    return 0;
+}
+
+// Note en transit pendant les tris par comptage
+typedef struct {
+    uint32_t user;
+    uint32_t item;
+    uint8_t value;
+} triplet_t;
+
+// Construit le store à partir de segments en colonnes, parcourus dans l'ordre
+static int build_from_segments(rating_store_t *store, const rating_columns_t *segments, size_t num_segments,
+                               size_t num_users, size_t num_items)
+{
+    memset(store, 0, sizeof(*store));
+    store->num_users = num_users;
+    store->num_items = num_items;
+
+    size_t buckets = (num_users > num_items ? num_users : num_items) + 1;
+    uint64_t *count = calloc(buckets, sizeof(uint64_t));
+    if (count == NULL) {
+        return -1;
+    }
+
+    // Passe 1 : histogramme des items (les entrées hors bornes sont ignorées)
+    size_t valid = 0;
+    for (size_t s = 0; s < num_segments; s++) {
+        const rating_columns_t *seg = &segments[s];
+        for (size_t t = 0; t < seg->len; t++) {
+            if (seg->user[t] < num_users && seg->item[t] < num_items) {
+                count[seg->item[t] + 1]++;
+                valid++;
+            }
+        }
+    }
+
+    triplet_t *by_item = malloc((valid ? valid : 1) * sizeof(triplet_t));
+    triplet_t *by_user = malloc((valid ? valid : 1) * sizeof(triplet_t));
+    if (!by_item || !by_user) {
+        free(by_item);
+        free(by_user);
+        free(count);
+        return -1;
+    }
+
+    // Tri par comptage stable sur l'item
+    for (size_t i = 0; i < num_items; i++) {
+        count[i + 1] += count[i];
+    }
+    for (size_t s = 0; s < num_segments; s++) {
+        const rating_columns_t *seg = &segments[s];
+        for (size_t t = 0; t < seg->len; t++) {
+            if (seg->user[t] < num_users && seg->item[t] < num_items) {
+                triplet_t *dst = &by_item[count[seg->item[t]]++];
+                dst->user = seg->user[t];
+                dst->item = seg->item[t];
+                dst->value = seg->rating[t];
+            }
+        }
+    }
+
+    // Passe 2 : tri par comptage stable sur le user.
+    // Chaque ligne est alors triée par item, les doublons dans l'ordre d'arrivée.
+    memset(count, 0, buckets * sizeof(uint64_t));
+    for (size_t t = 0; t < valid; t++) {
+        count[by_item[t].user + 1]++;
+    }
+    for (size_t u = 0; u < num_users; u++) {
+        count[u + 1] += count[u];
+    }
+    for (size_t t = 0; t < valid; t++) {
+        by_user[count[by_item[t].user]++] = by_item[t];
+    }
+    free(by_item);
+    free(count);
+
+    if (alloc_view(&store->by_user, num_users, num_items, valid) != 0) {
+        free(by_user);
+        return -1;
+    }
+
+    // Compactage : on ne garde que la dernière note de chaque couple
+    size_t nnz = 0;
+    for (size_t t = 0; t < valid; t++) {
+        const triplet_t *r = &by_user[t];
+        if (t + 1 < valid && by_user[t + 1].user == r->user && by_user[t + 1].item == r->item) {
+            continue;
+        }
+        store->by_user.index[nnz] = r->item;
+        store->by_user.value[nnz] = r->value;
+        store->by_user.offsets[r->user + 1]++;
+        nnz++;
+    }
+    free(by_user);
+
+    for (size_t u = 0; u < num_users; u++) {
+        store->by_user.offsets[u + 1] += store->by_user.offsets[u];
+    }
+    store->by_user.nnz = nnz;
+    store->nnz = nnz;
+
+    if (transpose_view(&store->by_user, &store->by_item) != 0) {
+        store_free(store);
+        return -1;
+    }
+
+    return 0;
+}
+
+int store_build(rating_store_t *store, const uint32_t *users, const uint32_t *items,
+                const uint8_t *values, size_t n, size_t num_users, size_t num_items)
+{
+    rating_columns_t columns = {0};
+    columns.user = users;
+    columns.item = items;
+    columns.rating = values;
+    columns.len = n;
+    return build_from_segments(store, &columns, 1, num_users, num_items);
+}
+
+int store_build_from_log(rating_store_t *store, const rating_log_t *log,
+                         size_t num_users, size_t num_items)
+{
+    size_t num_segments = rating_log_num_segments(log);
+    rating_columns_t *segments = malloc((num_segments ? num_segments : 1) * sizeof(rating_columns_t));
+    if (segments == NULL) {
+        memset(store, 0, sizeof(*store));
+        return -1;
+    }
+
+    for (size_t s = 0; s < num_segments; s++) {
+        segments[s] = rating_log_segment(log, s);
+    }
+
+    int rc = build_from_segments(store, segments, num_segments, num_users, num_items);
+    free(segments);
+    return rc;
+}
+
+void store_free(rating_store_t *store)
+{
+    if (store == NULL) {
+        return;
+    }
+    if (!store->borrowed) {
+        free_view(&store->by_user);
+        free_view(&store->by_item);
+    }
+    memset(store, 0, sizeof(*store));
+}
+
+size_t sparse_row(const sparse_view_t *view, size_t row, const uint32_t **index, const uint8_t **value)
+{
+    if (view->offsets == NULL || row >= view->n_rows) {
+        if (index) *index = NULL;
+        if (value) *value = NULL;
+        return 0;
+    }
+
+    uint64_t begin = view->offsets[row];
+    if (index) *index = view->index + begin;
+    if (value) *value = view->value + begin;
+    return (size_t)(view->offsets[row + 1] - begin);
+}
+
+int sparse_find(const sparse_view_t *view, size_t row, uint32_t col)
+{
+    const uint32_t *index;
+    const uint8_t *value;
+    size_t len = sparse_row(view, row, &index, &value);
+
+    size_t lo = 0, hi = len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index[mid] < col) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo < len && index[lo] == col) {
+        return value[lo];
+    }
+    return STORE_NO_RATING;
+}
+
+int store_get(const rating_store_t *store, size_t user, size_t item)
+{
+    if (item >= store->num_items) {
+        return STORE_NO_RATING;
+    }
+    return sparse_find(&store->by_user, user, (uint32_t)item);
+}
+
+size_t store_user_profile(const rating_store_t *store, size_t user,
+                          const uint32_t **items, const uint8_t **values)
+{
+    return sparse_row(&store->by_user, user, items, values);
+}
+
+size_t store_item_profile(const rating_store_t *store, size_t item,
+                          const uint32_t **users, const uint8_t **values)
+{
+    return sparse_row(&store->by_item, item, users, values);
+}
@@ -0,0 +1,56 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rating_log.h"
+
+// Valeur renvoyée quand un couple (user, item) n'a pas de note
+#define STORE_NO_RATING -1
+
+// Vue creuse d'une matrice de notes.
+// by_user (CSR) : lignes = users, colonnes = items
+// by_item (CSC) : lignes = items, colonnes = users
+// Le profil de la ligne r occupe [offsets[r], offsets[r + 1]) et ses
+// colonnes sont triées par ordre croissant.
+typedef struct SparseView {
+    size_t n_rows;
+    size_t n_cols;
+    size_t nnz;
+    uint64_t *offsets;   // n_rows + 1 entrées
+    uint32_t *index;     // nnz indices de colonnes
+    uint8_t *value;      // nnz notes x10 (0-50), même échelle que le serveur
+} sparse_view_t;
+
+// Stockage creux des notes, construit à partir du journal des ratings.
+// La mémoire est proportionnelle au nombre de notes, pas à users x items.
+typedef struct RatingStore {
+    size_t num_users;
+    size_t num_items;
+    size_t nnz;
+    sparse_view_t by_user;
+    sparse_view_t by_item;
+    int borrowed;        // vues en lecture seule (snapshot mmap), à ne pas libérer
+} rating_store_t;
+
+// Construit les vues CSR/CSC à partir de n triplets (users[t], items[t], values[t]).
+// Si un couple apparaît plusieurs fois, la dernière note l'emporte.
+// Retourne 0 en cas de succès, -1 en cas d'échec d'allocation.
+extern int store_build(rating_store_t *store, const uint32_t *users, const uint32_t *items,
+                       const uint8_t *values, size_t n, size_t num_users, size_t num_items);
+extern int store_build_from_log(rating_store_t *store, const rating_log_t *log,
+                                size_t num_users, size_t num_items);
+extern void store_free(rating_store_t *store);
+
+// Recherche dichotomique O(log d) ; retourne la note x10 ou STORE_NO_RATING
+extern int sparse_find(const sparse_view_t *view, size_t row, uint32_t col);
+extern size_t sparse_row(const sparse_view_t *view, size_t row, const uint32_t **index, const uint8_t **value);
+
+extern int store_get(const rating_store_t *store, size_t user, size_t item);
+extern size_t store_user_profile(const rating_store_t *store, size_t user,
+                                 const uint32_t **items, const uint8_t **values);
+extern size_t store_item_profile(const rating_store_t *store, size_t item,
+                                 const uint32_t **users, const uint8_t **values);
+
+#endif // STORE_H
@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "topn.h"
+
+// a est-il mieux classé que b ?
+static int ranks_before(const scored_id_t *a, const scored_id_t *b)
+{
+    if (a->score != b->score) {
+        return a->score > b->score;
+    }
+    return a->id < b->id;
+}
+
+static void swap(scored_id_t *a, scored_id_t *b)
+{
+    scored_id_t t = *a;
+    *a = *b;
+    *b = t;
+}
+
+int topn_init(topn_t *top, size_t n)
+{
+    memset(top, 0, sizeof(*top));
+    if (n == 0) {
+        return 0;
+    }
+    top->heap = malloc(n * sizeof(scored_id_t));
+    if (top->heap == NULL) {
+        return -1;
+    }
+    top->capacity = n;
+    return 0;
+}
+
+void topn_free(topn_t *top)
+{
+    free(top->heap);
+    memset(top, 0, sizeof(*top));
+}
+
+// Tas dont la racine est le candidat le moins bien classé
+static void sift_down(scored_id_t *heap, size_t len, size_t i)
+{
+    for (;;) {
+        size_t worst = i;
+        size_t l = 2 * i + 1, r = l + 1;
+        if (l < len && ranks_before(&heap[worst], &heap[l])) worst = l;
+        if (r < len && ranks_before(&heap[worst], &heap[r])) worst = r;
+        if (worst == i) {
+            return;
+        }
+        swap(&heap[i], &heap[worst]);
+        i = worst;
+    }
+}
+
+static void sift_up(scored_id_t *heap, size_t i)
+{
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!ranks_before(&heap[parent], &heap[i])) {
+            return;
+        }
+        swap(&heap[parent], &heap[i]);
+        i = parent;
+    }
+}
+
+int topn_accepts(const topn_t *top, uint32_t id, double score)
+{
+    if (top->len < top->capacity) {
+        return 1;
+    }
+    scored_id_t candidate = { id, score };
+    return top->capacity > 0 && ranks_before(&candidate, &top->heap[0]);
+}
+
+void topn_push(topn_t *top, uint32_t id, double score)
+{
+    scored_id_t candidate = { id, score };
+
+    if (top->len < top->capacity) {
+        top->heap[top->len] = candidate;
+        sift_up(top->heap, top->len++);
+    } else if (top->capacity > 0 && ranks_before(&candidate, &top->heap[0])) {
+        top->heap[0] = candidate;
+        sift_down(top->heap, top->len, 0);
+    }
+}
+
+size_t topn_finish(topn_t *top)
+{
+    // Tri par tas : on retire la racine (le moins bon) vers la fin
+    size_t len = top->len;
+    for (size_t end = len; end > 1; end--) {
+        swap(&top->heap[0], &top->heap[end - 1]);
+        sift_down(top->heap, end - 1, 0);
+    }
+    top->len = 0;
+    return len;
+}
+
+static int compare_scored(const void *a, const void *b)
+{
+    const scored_id_t *x = a;
+    const scored_id_t *y = b;
+    if (ranks_before(x, y)) return -1;
+    if (ranks_before(y, x)) return 1;
+    return 0;
+}
+
+// Partition de Lomuto autour de la médiane de trois ; retourne la position du pivot
+static size_t partition(scored_id_t *items, size_t lo, size_t hi)
+{
+    size_t mid = lo + (hi - lo) / 2;
+    if (ranks_before(&items[mid], &items[lo])) swap(&items[mid], &items[lo]);
+    if (ranks_before(&items[hi], &items[lo])) swap(&items[hi], &items[lo]);
+    if (ranks_before(&items[hi], &items[mid])) swap(&items[hi], &items[mid]);
+    swap(&items[mid], &items[hi]);
+
+    size_t store = lo;
+    for (size_t i = lo; i < hi; i++) {
+        if (ranks_before(&items[i], &items[hi])) {
+            swap(&items[i], &items[store++]);
+        }
+    }
+    swap(&items[store], &items[hi]);
+    return store;
+}
+
+size_t topn_select(scored_id_t *items, size_t count, size_t n)
+{
+    if (n > count) {
+        n = count;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    // Quickselect : les n meilleurs se retrouvent dans items[0 .. n), O(count) en moyenne
+    size_t lo = 0, hi = count - 1;
+    while (n < count && lo < hi) {
+        size_t p = partition(items, lo, hi);
+        if (p == n - 1 || p == n) {
+            break;
+        }
+        if (p < n) {
+            lo = p + 1;
+        } else {
+            hi = p - 1;
+        }
+    }
+
+    qsort(items, n, sizeof(scored_id_t), compare_scored);
+    return n;
+}
@@ -0,0 +1,40 @@
+#ifndef TOPN_H
+#define TOPN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Candidat (identifiant dense, score). L'ordre de classement est score
+// décroissant puis identifiant croissant, ce qui rend le résultat
+// indépendant de l'ordre d'arrivée des candidats.
+typedef struct ScoredId {
+    uint32_t id;
+    double score;
+} scored_id_t;
+
+// Sélection bornée des N meilleurs candidats par tas : le pire candidat
+// gardé est à la racine, un nouveau candidat ne coûte O(log N) que s'il
+// le bat. Adapté à un flux de candidats de taille inconnue.
+typedef struct TopN {
+    scored_id_t *heap;
+    size_t len;
+    size_t capacity;
+} topn_t;
+
+// Retourne 0 en cas de succès, -1 en cas d'échec d'allocation (n peut être nul)
+extern int topn_init(topn_t *top, size_t n);
+extern void topn_free(topn_t *top);
+extern void topn_push(topn_t *top, uint32_t id, double score);
+
+// Le candidat a-t-il une chance d'entrer ? (évite de calculer un score inutile)
+extern int topn_accepts(const topn_t *top, uint32_t id, double score);
+
+// Trie le contenu du tas du meilleur au moins bon et en retourne la taille.
+// Le tas est vidé : top->heap[0 .. retour) contient le classement.
+extern size_t topn_finish(topn_t *top);
+
+// Variante en place sur un tableau complet (quickselect puis tri des N
+// premiers) : items[0 .. retour) reçoit les min(n, count) meilleurs, triés.
+extern size_t topn_select(scored_id_t *items, size_t count, size_t n);
+
+#endif // TOPN_H
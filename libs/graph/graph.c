@@ -3,56 +3,135 @@
 #include <string.h>
 #include <math.h>
 
+#include <core/topn.h>
+
 #include "graph.h"
 
+// Allocate and reset PageRank scores
+static void init_scores(b_graph_t* g) {
+    int total_nodes = g->num_users + g->num_items;
+
+    g->pr = malloc((total_nodes > 0 ? total_nodes : 1) * sizeof(double));
+    g->pr_new = malloc((total_nodes > 0 ? total_nodes : 1) * sizeof(double));
+    if(!g->pr || !g->pr_new) {
+        // Pas de scores du tout : les appelants testent g->pr
+        fprintf(stderr, "Error: Failed to allocate PageRank scores\n");
+        free(g->pr);
+        free(g->pr_new);
+        g->pr = g->pr_new = NULL;
+        return;
+    }
+
+    double initial_pr = total_nodes > 0 ? 1.0 / total_nodes : 0.0;
+    for(int i = 0; i < total_nodes; i++) {
+        g->pr[i] = initial_pr;
+        g->pr_new[i] = 0.0;
+    }
+}
+
 // Initialize the graph
 void init_graph(b_graph_t* g, int users, int items) {
+    memset(g, 0, sizeof(*g));
     g->num_users = users;
     g->num_items = items;
-    
-    // Initialize adjacency matrix to 0
-    for(int i = 0; i < users; i++) {
-        for(int j = 0; j < items; j++) {
-            g->user_item[i][j] = 0;
-        }
+    init_scores(g);
+}
+
+// Initialize the graph on top of an existing rating store (borrowed, not copied)
+void init_graph_from_store(b_graph_t* g, const rating_store_t* store) {
+    init_graph(g, (int)store->num_users, (int)store->num_items);
+    g->adjacency = store;
+}
+
+void free_graph(b_graph_t* g) {
+    store_free(&g->own_adjacency);
+    free(g->edge_users);
+    free(g->edge_items);
+    free(g->pr);
+    free(g->pr_new);
+    memset(g, 0, sizeof(*g));
+}
+
+// Build the CSR/CSC adjacency from the interactions added so far
+static const rating_store_t* graph_adjacency(b_graph_t* g) {
+    if(g->adjacency != NULL) {
+        return g->adjacency;
     }
-    
-    // Initialize PageRank scores
-    double initial_pr = 1.0 / (users + items);
-    for(int i = 0; i < users + items; i++) {
-        g->pr[i] = initial_pr;
-        g->pr_new[i] = 0.0;
+
+    uint8_t *ones = malloc(g->num_edges ? g->num_edges : 1);
+    if(ones == NULL) {
+        return NULL;
+    }
+    memset(ones, 1, g->num_edges);
+
+    if(store_build(&g->own_adjacency, g->edge_users, g->edge_items, ones,
+                   g->num_edges, g->num_users, g->num_items) == 0) {
+        g->adjacency = &g->own_adjacency;
     }
+    free(ones);
+    return g->adjacency;
 }
 
 // Add user-item interaction
 void add_interaction(b_graph_t* g, int user, int item) {
-    if(user < g->num_users && item < g->num_items) {
-        g->user_item[user][item] = 1;
+    if(g->adjacency != NULL && g->adjacency != &g->own_adjacency) {
+        fprintf(stderr, "Error: Cannot add interactions to a graph backed by a rating store\n");
+        return;
+    }
+    if(user < 0 || item < 0 || user >= g->num_users || item >= g->num_items) {
+        return;
+    }
+
+    if(g->num_edges == g->cap_edges) {
+        size_t cap = g->cap_edges ? g->cap_edges * 2 : 64;
+        uint32_t *users = realloc(g->edge_users, cap * sizeof(uint32_t));
+        if(users) g->edge_users = users;
+        uint32_t *items = realloc(g->edge_items, cap * sizeof(uint32_t));
+        if(items) g->edge_items = items;
+        if(!users || !items) {
+            return;
+        }
+        g->cap_edges = cap;
     }
+
+    g->edge_users[g->num_edges] = (uint32_t)user;
+    g->edge_items[g->num_edges] = (uint32_t)item;
+    g->num_edges++;
+
+    // The adjacency will be rebuilt on next use
+    store_free(&g->own_adjacency);
+    g->adjacency = NULL;
 }
 
 // Get out-degree for a node
 int get_out_degree(b_graph_t* g, int node) {
-    int degree = 0;
-    
+    const rating_store_t *adj = graph_adjacency(g);
+    if(adj == NULL) {
+        return 0;
+    }
+
+    const uint8_t *values;
+    size_t len;
     if(node < g->num_users) { // User node
-        for(int j = 0; j < g->num_items; j++) {
-            degree += g->user_item[node][j];
-        }
+        len = store_user_profile(adj, node, NULL, &values);
     } else { // Item node
-        int item_id = node - g->num_users;
-        for(int i = 0; i < g->num_users; i++) {
-            degree += g->user_item[i][item_id];
-        }
+        len = store_item_profile(adj, node - g->num_users, NULL, &values);
+    }
+
+    int degree = 0;
+    for(size_t e = 0; e < len; e++) {
+        degree += values[e] > 0;
     }
-    
     return degree;
 }
 
 // PageRank iteration
 void pagerank_iteration(b_graph_t* g) {
     int total_nodes = g->num_users + g->num_items;
+    const rating_store_t *adj = graph_adjacency(g);
+    if(g->pr == NULL || g->pr_new == NULL) {
+        return;
+    }
     
     // Reset new PageRank values
     for(int i = 0; i < total_nodes; i++) {
@@ -60,38 +139,44 @@ void pagerank_iteration(b_graph_t* g) {
     }
     
     // Calculate PageRank for each node
-    for(int i = 0; i < total_nodes; i++) {
+    for(int i = 0; adj != NULL && i < total_nodes; i++) {
         int out_degree = get_out_degree(g, i);
         
         if(out_degree > 0) {
             double contribution = DAMPING_FACTOR * g->pr[i] / out_degree;
+            const uint32_t *neighbors;
+            const uint8_t *values;
             
             if(i < g->num_users) { // User node - contribute to connected items
-                for(int j = 0; j < g->num_items; j++) {
-                    if(g->user_item[i][j] == 1) {
-                        g->pr_new[g->num_users + j] += contribution;
+                size_t len = store_user_profile(adj, i, &neighbors, &values);
+                for(size_t e = 0; e < len; e++) {
+                    if(values[e] > 0) {
+                        g->pr_new[g->num_users + neighbors[e]] += contribution;
                     }
                 }
             } else { // Item node - contribute to connected users
-                int item_id = i - g->num_users;
-                for(int j = 0; j < g->num_users; j++) {
-                    if(g->user_item[j][item_id] == 1) {
-                        g->pr_new[j] += contribution;
+                size_t len = store_item_profile(adj, i - g->num_users, &neighbors, &values);
+                for(size_t e = 0; e < len; e++) {
+                    if(values[e] > 0) {
+                        g->pr_new[neighbors[e]] += contribution;
                     }
                 }
             }
         }
     }
     
-    // Update PageRank values
-    for(int i = 0; i < total_nodes; i++) {
-        g->pr[i] = g->pr_new[i];
-    }
+    // Swap buffers: pr holds the new scores, pr_new the previous ones
+    double *previous = g->pr;
+    g->pr = g->pr_new;
+    g->pr_new = previous;
 }
 
 // Check convergence
 int has_converged(b_graph_t* g) {
     int total_nodes = g->num_users + g->num_items;
+    if(g->pr == NULL || g->pr_new == NULL) {
+        return 1;
+    }
     
     for(int i = 0; i < total_nodes; i++) {
         if(fabs(g->pr[i] - g->pr_new[i]) > EPSILON) {
@@ -121,44 +206,34 @@ void run_pagerank(b_graph_t* g) {
 void get_graph_recommendations(b_graph_t* g, int user_id, int top_n) {
     printf("\nTop-%d recommendations for User %d:\n", top_n, user_id);
     
-    // Create array of item scores
-    typedef struct {
-        int item_id;
-        double score;
-    } ItemScore;
-    
-    ItemScore items[max_items];
-    int count = 0;
-    
-    // Collect items not already interacted with
-    for(int i = 0; i < g->num_items; i++) {
-        if(g->user_item[user_id][i] == 0) { // Not already interacted
-            items[count].item_id = i;
-            items[count].score = g->pr[g->num_users + i];
-            count++;
-        }
+    const rating_store_t *adj = graph_adjacency(g);
+    topn_t top;
+    if(adj == NULL || g->pr == NULL || topn_init(&top, top_n > 0 ? top_n : 0) != 0) {
+        return;
     }
     
-    // Sort items by PageRank score (descending)
-    for(int i = 0; i < count - 1; i++) {
-        for(int j = i + 1; j < count; j++) {
-            if(items[j].score > items[i].score) {
-                ItemScore temp = items[i];
-                items[i] = items[j];
-                items[j] = temp;
-            }
+    // Keep the best items not already interacted with
+    for(int i = 0; i < g->num_items; i++) {
+        if(store_get(adj, user_id, i) <= 0) { // Not already interacted
+            topn_push(&top, i, g->pr[g->num_users + i]);
         }
     }
     
     // Print top-N recommendations
-    int recommendations = (top_n < count) ? top_n : count;
-    for(int i = 0; i < recommendations; i++) {
-        printf("Item %d (score: %.6f)\n", items[i].item_id, items[i].score);
+    size_t recommendations = topn_finish(&top);
+    for(size_t i = 0; i < recommendations; i++) {
+        printf("Item %u (score: %.6f)\n", top.heap[i].id, top.heap[i].score);
     }
+    topn_free(&top);
 }
 
 // Print adjacency matrix
 void print_adjacency_matrix(b_graph_t* g) {
+    const rating_store_t *adj = graph_adjacency(g);
+    if(adj == NULL) {
+        return;
+    }
+
     printf("\nAdjacency Matrix:\n");
     printf("    ");
     for(int j = 0; j < g->num_items; j++) {
@@ -169,7 +244,7 @@ void print_adjacency_matrix(b_graph_t* g) {
     for(int i = 0; i < g->num_users; i++) {
         printf("U%d  ", i);
         for(int j = 0; j < g->num_items; j++) {
-            printf("%d  ", g->user_item[i][j]);
+            printf("%d  ", store_get(adj, i, j) > 0);
         }
         printf("\n");
     }
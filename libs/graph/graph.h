@@ -1,23 +1,34 @@
 #ifndef GRAPH
 #define GRAPH
 
+#include <stddef.h>
+#include <stdint.h>
+#include <core/store.h>
 
-#define max_users 9999
-#define max_items 9999
 #define MAX_ITER 50
 #define DAMPING_FACTOR 0.85
 #define EPSILON 1e-6
 
+// Graphe biparti users/items. Les arêtes sont lues dans un rating_store_t :
+// by_user donne les voisins d'un user, by_item ceux d'un item. Seules les
+// notes strictement positives comptent comme interactions.
 typedef struct BipartiteGraph {
     int num_users;
     int num_items;
-    int user_item[max_users][max_items];  // Adjacency matrix
-    double pr[max_users + max_items];     // PageRank scores
-    double pr_new[max_users + max_items]; 
+    const rating_store_t *adjacency;  // store emprunté ou &own_adjacency
+    rating_store_t own_adjacency;     // construit à partir des add_interaction()
+    uint32_t *edge_users;
+    uint32_t *edge_items;
+    size_t num_edges;
+    size_t cap_edges;
+    double *pr;                       // PageRank scores
+    double *pr_new;
 } b_graph_t;
 
 
 void init_graph(b_graph_t* g, int users, int items);
+void init_graph_from_store(b_graph_t* g, const rating_store_t* store);
+void free_graph(b_graph_t* g);
 void add_interaction(b_graph_t* g, int user, int item);
 int get_out_degree(b_graph_t* g, int node);
 void pagerank_iteration(b_graph_t* g);
@@ -28,4 +39,4 @@ void print_adjacency_matrix(b_graph_t* g);
 void print_pagerank_scores(b_graph_t* g);
 
 
-#endif // !GRAPH
\ No newline at end of file
+#endif // !GRAPH
@@ -31,5 +31,7 @@ int main() {
         get_graph_recommendations(&graph, user, 3);
     }
     
+    free_graph(&graph);
+    
     return 0;
 }
\ No newline at end of file
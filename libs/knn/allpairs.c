@@ -0,0 +1,297 @@
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+
+#include "knn.h"
+
+// Matrice normalisée : une valeur float par note, dans l'ordre de la vue
+// des lignes (rows) et dans celui de la vue transposée (cols)
+typedef struct {
+    const sparse_view_t *rows;
+    const sparse_view_t *cols;
+    float *row_values;
+    float *col_values;
+    size_t m;
+} normalized_t;
+
+// Accumulateurs d'un worker, réutilisés d'une ligne à l'autre
+typedef struct {
+    double *acc;
+    uint8_t *seen;
+    uint32_t *touched;
+    topn_t top;
+} pair_scratch_t;
+
+typedef struct {
+    const normalized_t *matrix;
+    pair_scratch_t *scratch;
+    size_t first_row;
+    uint32_t *neighbors;     // bloc courant, block_rows x m
+    float *scores;
+} pair_block_t;
+
+// Centre et norme de chaque ligne selon la similarité, puis valeurs
+// normalisées des deux vues : a[r][c] = (note - centre_ligne[r] - centre_colonne[c]) / |ligne r|
+static int normalize(normalized_t *mat, similarity_kind_t kind)
+{
+    const sparse_view_t *rows = mat->rows;
+    const sparse_view_t *cols = mat->cols;
+    double *row_center = calloc(rows->n_rows ? rows->n_rows : 1, sizeof(double));
+    double *inv_norm = calloc(rows->n_rows ? rows->n_rows : 1, sizeof(double));
+    double *col_center = calloc(cols->n_rows ? cols->n_rows : 1, sizeof(double));
+    mat->row_values = malloc((rows->nnz ? rows->nnz : 1) * sizeof(float));
+    mat->col_values = malloc((cols->nnz ? cols->nnz : 1) * sizeof(float));
+    if (!row_center || !inv_norm || !col_center || !mat->row_values || !mat->col_values) {
+        free(row_center);
+        free(inv_norm);
+        free(col_center);
+        return -1;
+    }
+
+    if (kind == SIM_ADJUSTED_COSINE) {
+        for (size_t c = 0; c < cols->n_rows; c++) {
+            double sum = 0.0;
+            for (uint64_t e = cols->offsets[c]; e < cols->offsets[c + 1]; e++) {
+                sum += cols->value[e] / 10.0;
+            }
+            size_t len = cols->offsets[c + 1] - cols->offsets[c];
+            col_center[c] = len ? sum / len : 0.0;
+        }
+    }
+
+    for (size_t r = 0; r < rows->n_rows; r++) {
+        uint64_t begin = rows->offsets[r], end = rows->offsets[r + 1];
+        if (kind == SIM_PEARSON && end > begin) {
+            double sum = 0.0;
+            for (uint64_t e = begin; e < end; e++) {
+                sum += rows->value[e] / 10.0;
+            }
+            row_center[r] = sum / (end - begin);
+        }
+        double norm = 0.0;
+        for (uint64_t e = begin; e < end; e++) {
+            double v = rows->value[e] / 10.0 - row_center[r] - col_center[rows->index[e]];
+            mat->row_values[e] = (float)v;
+            norm += v * v;
+        }
+        inv_norm[r] = norm > 1e-12 ? 1.0 / sqrt(norm) : 0.0;
+        for (uint64_t e = begin; e < end; e++) {
+            mat->row_values[e] = (float)(mat->row_values[e] * inv_norm[r]);
+        }
+    }
+
+    for (size_t c = 0; c < cols->n_rows; c++) {
+        for (uint64_t e = cols->offsets[c]; e < cols->offsets[c + 1]; e++) {
+            uint32_t r = cols->index[e];
+            mat->col_values[e] = (float)((cols->value[e] / 10.0 - row_center[r] - col_center[c]) * inv_norm[r]);
+        }
+    }
+
+    free(row_center);
+    free(inv_norm);
+    free(col_center);
+    return 0;
+}
+
+// Lignes [begin, end) du bloc : produit creux ligne r x vue transposée,
+// qui ne visite que les lignes partageant au moins une colonne avec r
+static void compute_rows(void *arg, size_t begin, size_t end, size_t worker)
+{
+    pair_block_t *block = arg;
+    const normalized_t *mat = block->matrix;
+    const sparse_view_t *rows = mat->rows;
+    const sparse_view_t *cols = mat->cols;
+    pair_scratch_t *s = &block->scratch[worker];
+
+    for (size_t b = begin; b < end; b++) {
+        size_t r = block->first_row + b;
+        size_t n_touched = 0;
+
+        for (uint64_t e = rows->offsets[r]; e < rows->offsets[r + 1]; e++) {
+            double x = mat->row_values[e];
+            uint32_t c = rows->index[e];
+            if (x == 0.0) {
+                continue;
+            }
+            for (uint64_t f = cols->offsets[c]; f < cols->offsets[c + 1]; f++) {
+                uint32_t other = cols->index[f];
+                if (!s->seen[other]) {
+                    s->seen[other] = 1;
+                    s->touched[n_touched++] = other;
+                }
+                s->acc[other] += x * mat->col_values[f];
+            }
+        }
+
+        for (size_t t = 0; t < n_touched; t++) {
+            uint32_t other = s->touched[t];
+            if (other != r && s->acc[other] != 0.0) {
+                topn_push(&s->top, other, s->acc[other]);
+            }
+            s->acc[other] = 0.0;
+            s->seen[other] = 0;
+        }
+
+        size_t len = topn_finish(&s->top);
+        uint32_t *ids = block->neighbors + b * mat->m;
+        float *scores = block->scores + b * mat->m;
+        for (size_t j = 0; j < mat->m; j++) {
+            ids[j] = j < len ? s->top.heap[j].id : KNN_TABLE_NONE;
+            scores[j] = j < len ? (float)s->top.heap[j].score : 0.0f;
+        }
+    }
+}
+
+static int write_block(FILE *f, off_t offset, const void *data, size_t size)
+{
+    return fseeko(f, offset, SEEK_SET) == 0 && fwrite(data, 1, size, f) == size ? 0 : -1;
+}
+
+int allpairs_build(const rating_store_t *store, const allpairs_options_t *options, const char *path)
+{
+    normalized_t mat;
+    memset(&mat, 0, sizeof(mat));
+    mat.rows = options->side == ALLPAIRS_USERS ? &store->by_user : &store->by_item;
+    mat.cols = options->side == ALLPAIRS_USERS ? &store->by_item : &store->by_user;
+    mat.m = options->m ? options->m : 1;
+
+    size_t n_rows = mat.rows->n_rows;
+    size_t block_rows = options->block_rows ? options->block_rows : ALLPAIRS_BLOCK_ROWS;
+    size_t workers = pool_size(options->pool);
+
+    // Mémoire bornée : valeurs normalisées (2 x nnz), un bloc de résultats
+    // et des accumulateurs denses par worker, indépendamment de n_rows^2
+    uint32_t *neighbors = malloc(block_rows * mat.m * sizeof(uint32_t));
+    float *scores = malloc(block_rows * mat.m * sizeof(float));
+    pair_scratch_t *scratch = calloc(workers, sizeof(pair_scratch_t));
+    int rc = (neighbors && scores && scratch && normalize(&mat, options->similarity) == 0) ? 0 : -1;
+    for (size_t w = 0; w < workers && rc == 0; w++) {
+        scratch[w].acc = calloc(n_rows ? n_rows : 1, sizeof(double));
+        scratch[w].seen = calloc(n_rows ? n_rows : 1, sizeof(uint8_t));
+        scratch[w].touched = malloc((n_rows ? n_rows : 1) * sizeof(uint32_t));
+        if (!scratch[w].acc || !scratch[w].seen || !scratch[w].touched ||
+            topn_init(&scratch[w].top, mat.m) != 0) {
+            rc = -1;
+        }
+    }
+
+    // Écriture dans un fichier temporaire puis renommage, comme le snapshot
+    char tmp_path[4096];
+    FILE *f = NULL;
+    if (rc == 0 && snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        rc = -1;
+    }
+    if (rc == 0 && (f = fopen(tmp_path, "wb")) == NULL) {
+        perror("Failed to create similarity table");
+        rc = -1;
+    }
+
+    allpairs_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ALLPAIRS_MAGIC, sizeof(ALLPAIRS_MAGIC));
+    header.side = options->side;
+    header.similarity = options->similarity;
+    header.num_rows = n_rows;
+    header.m = mat.m;
+    header.nnz = store->nnz;
+    header.fingerprint = options->fingerprint;
+    off_t neighbors_at = sizeof(header);
+    off_t scores_at = neighbors_at + (off_t)(n_rows * mat.m * sizeof(uint32_t));
+    if (rc == 0) {
+        rc = write_block(f, 0, &header, sizeof(header));
+    }
+
+    // Bloc par bloc : calcul parallèle des lignes du bloc, puis écriture
+    for (size_t first = 0; first < n_rows && rc == 0; first += block_rows) {
+        size_t count = n_rows - first < block_rows ? n_rows - first : block_rows;
+        pair_block_t block = { &mat, scratch, first, neighbors, scores };
+        pool_parallel_for(options->pool, count, 16, compute_rows, &block);
+
+        rc = write_block(f, neighbors_at + (off_t)(first * mat.m * sizeof(uint32_t)), neighbors,
+                         count * mat.m * sizeof(uint32_t));
+        if (rc == 0) {
+            rc = write_block(f, scores_at + (off_t)(first * mat.m * sizeof(float)), scores,
+                             count * mat.m * sizeof(float));
+        }
+    }
+
+    if (f != NULL) {
+        if (fclose(f) != 0) {
+            rc = -1;
+        }
+        if (rc != 0 || rename(tmp_path, path) != 0) {
+            fprintf(stderr, "Error: Failed to write similarity table %s\n", path);
+            remove(tmp_path);
+            rc = -1;
+        }
+    }
+
+    for (size_t w = 0; scratch != NULL && w < workers; w++) {
+        free(scratch[w].acc);
+        free(scratch[w].seen);
+        free(scratch[w].touched);
+        topn_free(&scratch[w].top);
+    }
+    free(scratch);
+    free(neighbors);
+    free(scores);
+    free(mat.row_values);
+    free(mat.col_values);
+    return rc;
+}
+
+int allpairs_load(const char *path, allpairs_header_t *header, uint32_t **neighbors, float **scores)
+{
+    *neighbors = NULL;
+    *scores = NULL;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+
+    if (fread(header, sizeof(*header), 1, f) != 1 ||
+        memcmp(header->magic, ALLPAIRS_MAGIC, sizeof(ALLPAIRS_MAGIC)) != 0 || header->m == 0) {
+        fprintf(stderr, "Error: %s is not a similarity table\n", path);
+        fclose(f);
+        return -1;
+    }
+    // Les voisins sont des index uint32 ; num_rows x m cases doivent tenir en mémoire
+    if (header->num_rows > UINT32_MAX || header->m > UINT32_MAX ||
+        header->num_rows > SIZE_MAX / sizeof(uint32_t) / header->m) {
+        fprintf(stderr, "Error: Similarity table %s is corrupted\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    size_t cells = header->num_rows * header->m;
+    *neighbors = malloc((cells ? cells : 1) * sizeof(uint32_t));
+    *scores = malloc((cells ? cells : 1) * sizeof(float));
+    if (*neighbors == NULL || *scores == NULL ||
+        fread(*neighbors, sizeof(uint32_t), cells, f) != cells ||
+        fread(*scores, sizeof(float), cells, f) != cells) {
+        fprintf(stderr, "Error: Failed to read similarity table %s\n", path);
+        free(*neighbors);
+        free(*scores);
+        *neighbors = NULL;
+        *scores = NULL;
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    for (size_t e = 0; e < cells; e++) {
+        if ((*neighbors)[e] != KNN_TABLE_NONE && (*neighbors)[e] >= header->num_rows) {
+            fprintf(stderr, "Error: Similarity table %s is corrupted\n", path);
+            free(*neighbors);
+            free(*scores);
+            *neighbors = NULL;
+            *scores = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,583 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "knn.h"
+
+#define HNSW_MAX_LEVEL 16
+
+// En-tête du fichier d'index (suivi, pour chaque noeud, de son niveau,
+// de ses compteurs et de ses listes de voisins)
+typedef struct HNSWHeader {
+    char magic[8];
+    uint64_t m;
+    uint64_t ef_construction;
+    uint64_t ef_search;
+    uint64_t num_nodes;
+    uint64_t entry;
+    int64_t max_level;
+    uint64_t rng;
+    uint64_t fingerprint;
+} hnsw_header_t;
+
+// Candidat en cours d'exploration (tas min sur la distance)
+typedef struct {
+    uint32_t id;
+    float distance;
+} hnsw_candidate_t;
+
+typedef struct {
+    hnsw_candidate_t *data;
+    size_t len;
+    size_t cap;
+} candidate_heap_t;
+
+static size_t level_capacity(const hnsw_t *h, int level)
+{
+    return level == 0 ? 2 * h->m : h->m;
+}
+
+static uint32_t *level_links(const hnsw_t *h, const hnsw_node_t *node, int level)
+{
+    return node->links + (level == 0 ? 0 : 2 * h->m + (size_t)(level - 1) * h->m);
+}
+
+static int heap_push(candidate_heap_t *heap, uint32_t id, float distance)
+{
+    if (heap->len == heap->cap) {
+        size_t cap = heap->cap ? heap->cap * 2 : 64;
+        hnsw_candidate_t *data = realloc(heap->data, cap * sizeof(hnsw_candidate_t));
+        if (data == NULL) {
+            return -1;
+        }
+        heap->data = data;
+        heap->cap = cap;
+    }
+    size_t i = heap->len++;
+    heap->data[i].id = id;
+    heap->data[i].distance = distance;
+    while (i > 0 && heap->data[(i - 1) / 2].distance > heap->data[i].distance) {
+        hnsw_candidate_t t = heap->data[i];
+        heap->data[i] = heap->data[(i - 1) / 2];
+        heap->data[(i - 1) / 2] = t;
+        i = (i - 1) / 2;
+    }
+    return 0;
+}
+
+static hnsw_candidate_t heap_pop(candidate_heap_t *heap)
+{
+    hnsw_candidate_t top = heap->data[0];
+    heap->data[0] = heap->data[--heap->len];
+    size_t i = 0;
+    for (;;) {
+        size_t min = i, l = 2 * i + 1, r = l + 1;
+        if (l < heap->len && heap->data[l].distance < heap->data[min].distance) min = l;
+        if (r < heap->len && heap->data[r].distance < heap->data[min].distance) min = r;
+        if (min == i) {
+            break;
+        }
+        hnsw_candidate_t t = heap->data[i];
+        heap->data[i] = heap->data[min];
+        heap->data[min] = t;
+        i = min;
+    }
+    return top;
+}
+
+// xorshift64* : tirage des niveaux reproductible d'une exécution à l'autre
+static double next_uniform(hnsw_t *h)
+{
+    h->rng ^= h->rng >> 12;
+    h->rng ^= h->rng << 25;
+    h->rng ^= h->rng >> 27;
+    uint64_t x = h->rng * 0x2545F4914F6CDD1DULL;
+    return ((x >> 11) + 1) * (1.0 / 9007199254740993.0);
+}
+
+static int random_level(hnsw_t *h)
+{
+    double level = -log(next_uniform(h)) / log((double)h->m);
+    return level < HNSW_MAX_LEVEL ? (int)level : HNSW_MAX_LEVEL;
+}
+
+int hnsw_init(hnsw_t *h, size_t m, size_t ef_construction, size_t ef_search,
+              hnsw_distance_t distance, const void *space)
+{
+    memset(h, 0, sizeof(*h));
+    h->m = m >= 2 ? m : 2;
+    h->ef_construction = ef_construction > h->m ? ef_construction : h->m;
+    h->ef_search = ef_search ? ef_search : 1;
+    h->distance = distance;
+    h->space = space;
+    h->max_level = -1;
+    h->rng = 0x9E3779B97F4A7C15ULL;
+    return 0;
+}
+
+void hnsw_free(hnsw_t *h)
+{
+    if (h == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < h->num_nodes; i++) {
+        free(h->nodes[i].links);
+        free(h->nodes[i].count);
+    }
+    free(h->nodes);
+    free(h->visited);
+    memset(h, 0, sizeof(*h));
+}
+
+static int alloc_node(hnsw_t *h, hnsw_node_t *node, int level)
+{
+    node->level = level;
+    node->count = calloc(level + 1, sizeof(uint32_t));
+    node->links = malloc((2 * h->m + (size_t)level * h->m) * sizeof(uint32_t));
+    return (node->count && node->links) ? 0 : -1;
+}
+
+static int reserve_nodes(hnsw_t *h, size_t n)
+{
+    if (n <= h->cap_nodes) {
+        return 0;
+    }
+    size_t cap = h->cap_nodes ? h->cap_nodes * 2 : 1024;
+    while (cap < n) {
+        cap *= 2;
+    }
+    hnsw_node_t *nodes = realloc(h->nodes, cap * sizeof(hnsw_node_t));
+    if (nodes == NULL) {
+        return -1;
+    }
+    h->nodes = nodes;
+    uint32_t *visited = realloc(h->visited, cap * sizeof(uint32_t));
+    if (visited == NULL) {
+        return -1;
+    }
+    memset(visited + h->cap_nodes, 0, (cap - h->cap_nodes) * sizeof(uint32_t));
+    h->visited = visited;
+    h->cap_nodes = cap;
+    return 0;
+}
+
+static void next_epoch(hnsw_t *h)
+{
+    if (++h->epoch == 0) {
+        memset(h->visited, 0, h->cap_nodes * sizeof(uint32_t));
+        h->epoch = 1;
+    }
+}
+
+// Descente gloutonne (ef = 1) du niveau from jusqu'au niveau to + 1
+static uint32_t greedy_descent(const hnsw_t *h, uint32_t query, uint32_t entry, int from, int to)
+{
+    float best = h->distance(h->space, query, entry);
+    for (int level = from; level > to; level--) {
+        int changed = 1;
+        while (changed) {
+            changed = 0;
+            const hnsw_node_t *node = &h->nodes[entry];
+            const uint32_t *links = level_links(h, node, level);
+            for (uint32_t j = 0; j < node->count[level]; j++) {
+                float d = h->distance(h->space, query, links[j]);
+                if (d < best) {
+                    best = d;
+                    entry = links[j];
+                    changed = 1;
+                }
+            }
+        }
+    }
+    return entry;
+}
+
+// Recherche en faisceau sur un niveau : results reçoit les ef plus proches
+// de query (score = -distance). query lui-même est ignoré.
+static int search_layer(hnsw_t *h, uint32_t query, uint32_t entry, size_t ef, int level, topn_t *results)
+{
+    candidate_heap_t candidates = {0};
+    next_epoch(h);
+
+    h->visited[entry] = h->epoch;
+    h->visited[query] = h->epoch;
+    float d = entry == query ? 0.0f : h->distance(h->space, query, entry);
+    if (heap_push(&candidates, entry, d) != 0) {
+        return -1;
+    }
+    if (entry != query) {
+        topn_push(results, entry, -d);
+    }
+
+    while (candidates.len > 0) {
+        hnsw_candidate_t c = heap_pop(&candidates);
+        if (results->len == ef && c.distance > -results->heap[0].score) {
+            break;
+        }
+
+        const hnsw_node_t *node = &h->nodes[c.id];
+        const uint32_t *links = level_links(h, node, level);
+        for (uint32_t j = 0; j < node->count[level]; j++) {
+            uint32_t n = links[j];
+            if (h->visited[n] == h->epoch) {
+                continue;
+            }
+            h->visited[n] = h->epoch;
+            float dn = h->distance(h->space, query, n);
+            if (results->len < ef || dn < -results->heap[0].score) {
+                if (heap_push(&candidates, n, dn) != 0) {
+                    free(candidates.data);
+                    return -1;
+                }
+                topn_push(results, n, -dn);
+            }
+        }
+    }
+
+    free(candidates.data);
+    return 0;
+}
+
+// Heuristique de sélection de HNSW (candidats triés par distance croissante
+// au noeud à relier) : un candidat est gardé s'il est plus proche de ce
+// noeud que de tout voisin déjà retenu, ce qui conserve des liens vers des
+// régions différentes ; les places restantes sont complétées par les
+// candidats écartés les plus proches
+static size_t select_neighbors(const hnsw_t *h, const scored_id_t *sorted, size_t n, size_t m,
+                               uint32_t *out)
+{
+    size_t len = 0;
+    uint8_t kept[n ? n : 1];
+    memset(kept, 0, sizeof(kept));
+
+    for (size_t i = 0; i < n && len < m; i++) {
+        float d = (float)-sorted[i].score;
+        int good = 1;
+        for (size_t r = 0; r < len && good; r++) {
+            if (h->distance(h->space, sorted[i].id, out[r]) < d) {
+                good = 0;
+            }
+        }
+        if (good) {
+            out[len++] = sorted[i].id;
+            kept[i] = 1;
+        }
+    }
+    for (size_t i = 0; i < n && len < m; i++) {
+        if (!kept[i]) {
+            out[len++] = sorted[i].id;
+        }
+    }
+    return len;
+}
+
+// Ajoute le lien node -> target au niveau level, en élaguant la liste si elle déborde
+static int add_link(hnsw_t *h, uint32_t node, uint32_t target, int level)
+{
+    hnsw_node_t *n = &h->nodes[node];
+    uint32_t *links = level_links(h, n, level);
+    size_t cap = level_capacity(h, level);
+
+    for (uint32_t j = 0; j < n->count[level]; j++) {
+        if (links[j] == target) {
+            return 0;
+        }
+    }
+    if (n->count[level] < cap) {
+        links[n->count[level]++] = target;
+        return 0;
+    }
+
+    topn_t all;
+    if (topn_init(&all, cap + 1) != 0) {
+        return -1;
+    }
+    for (uint32_t j = 0; j < n->count[level]; j++) {
+        topn_push(&all, links[j], -h->distance(h->space, node, links[j]));
+    }
+    topn_push(&all, target, -h->distance(h->space, node, target));
+    size_t len = topn_finish(&all);
+    n->count[level] = (uint32_t)select_neighbors(h, all.heap, len, cap, links);
+    topn_free(&all);
+    return 0;
+}
+
+// (Re)calcule les voisins de node aux niveaux [0, top], en partant de entry
+static int connect_node(hnsw_t *h, uint32_t node, uint32_t entry, int top)
+{
+    topn_t results;
+    if (topn_init(&results, h->ef_construction) != 0) {
+        return -1;
+    }
+
+    for (int level = top; level >= 0; level--) {
+        if (search_layer(h, node, entry, h->ef_construction, level, &results) != 0) {
+            topn_free(&results);
+            return -1;
+        }
+        size_t len = topn_finish(&results);
+        if (len == 0) {
+            continue;
+        }
+        entry = results.heap[0].id;
+
+        hnsw_node_t *n = &h->nodes[node];
+        uint32_t *links = level_links(h, n, level);
+        n->count[level] = (uint32_t)select_neighbors(h, results.heap, len, h->m, links);
+        for (uint32_t j = 0; j < n->count[level]; j++) {
+            if (add_link(h, links[j], node, level) != 0) {
+                topn_free(&results);
+                return -1;
+            }
+        }
+    }
+
+    topn_free(&results);
+    return 0;
+}
+
+int hnsw_insert(hnsw_t *h, uint32_t node)
+{
+    if (node != h->num_nodes || reserve_nodes(h, (size_t)node + 1) != 0) {
+        return -1;
+    }
+
+    int level = random_level(h);
+    if (alloc_node(h, &h->nodes[node], level) != 0) {
+        free(h->nodes[node].links);
+        free(h->nodes[node].count);
+        return -1;
+    }
+    h->num_nodes++;
+
+    if (h->max_level < 0) {
+        h->entry = node;
+        h->max_level = level;
+        return 0;
+    }
+
+    uint32_t entry = greedy_descent(h, node, h->entry, h->max_level, level);
+    if (connect_node(h, node, entry, level < h->max_level ? level : h->max_level) != 0) {
+        return -1;
+    }
+    if (level > h->max_level) {
+        h->entry = node;
+        h->max_level = level;
+    }
+    return 0;
+}
+
+int hnsw_update(hnsw_t *h, uint32_t node)
+{
+    if (node >= h->num_nodes) {
+        return -1;
+    }
+    if (h->num_nodes == 1) {
+        return 0;
+    }
+
+    // Le vecteur de node a changé : ses listes sont recalculées par une
+    // recherche depuis le point d'entrée. Les anciens liens restent en place
+    // pendant la recherche (node lui-même est exclu des résultats), ce qui
+    // garde le graphe connexe même quand node est le point d'entrée.
+    int level = h->nodes[node].level;
+    uint32_t entry = greedy_descent(h, node, h->entry, h->max_level, level);
+    return connect_node(h, node, entry, level);
+}
+
+int hnsw_search(hnsw_t *h, uint32_t query, size_t k, topn_t *out)
+{
+    if (query >= h->num_nodes || h->max_level < 0) {
+        return -1;
+    }
+
+    size_t ef = h->ef_search > k ? h->ef_search : k;
+    topn_t results;
+    if (topn_init(&results, ef) != 0) {
+        return -1;
+    }
+
+    uint32_t entry = greedy_descent(h, query, h->entry, h->max_level, 0);
+    if (search_layer(h, query, entry, ef, 0, &results) != 0) {
+        topn_free(&results);
+        return -1;
+    }
+
+    // Score rendu : similarité cosinus = 1 - distance
+    size_t len = topn_finish(&results);
+    for (size_t i = 0; i < len && i < k; i++) {
+        topn_push(out, results.heap[i].id, 1.0 + results.heap[i].score);
+    }
+    topn_free(&results);
+    return 0;
+}
+
+int hnsw_save(const hnsw_t *h, const char *path)
+{
+    hnsw_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HNSW_MAGIC, sizeof(HNSW_MAGIC));
+    header.m = h->m;
+    header.ef_construction = h->ef_construction;
+    header.ef_search = h->ef_search;
+    header.num_nodes = h->num_nodes;
+    header.entry = h->entry;
+    header.max_level = h->max_level;
+    header.rng = h->rng;
+    header.fingerprint = h->fingerprint;
+
+    // Écriture dans un fichier temporaire puis renommage : un serveur qui
+    // démarre ne voit jamais d'index à moitié écrit
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        return -1;
+    }
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        perror("Failed to create HNSW index");
+        return -1;
+    }
+    int rc = fwrite(&header, sizeof(header), 1, f) == 1 ? 0 : -1;
+    for (size_t i = 0; i < h->num_nodes && rc == 0; i++) {
+        const hnsw_node_t *n = &h->nodes[i];
+        int32_t level = n->level;
+        size_t links = 2 * h->m + (size_t)n->level * h->m;
+        if (fwrite(&level, sizeof(level), 1, f) != 1 ||
+            fwrite(n->count, sizeof(uint32_t), n->level + 1, f) != (size_t)n->level + 1 ||
+            fwrite(n->links, sizeof(uint32_t), links, f) != links) {
+            rc = -1;
+        }
+    }
+    if (fclose(f) != 0) {
+        rc = -1;
+    }
+    if (rc != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Error: Failed to write HNSW index %s\n", path);
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+int hnsw_load(hnsw_t *h, const char *path, hnsw_distance_t distance, const void *space)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        memset(h, 0, sizeof(*h));
+        return -1;
+    }
+
+    hnsw_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.magic, HNSW_MAGIC, sizeof(HNSW_MAGIC)) != 0 ||
+        header.m < 2 || header.m > 1024 || header.max_level > HNSW_MAX_LEVEL ||
+        (header.num_nodes > 0 && header.entry >= header.num_nodes)) {
+        fprintf(stderr, "Error: %s is not an HNSW index\n", path);
+        fclose(f);
+        memset(h, 0, sizeof(*h));
+        return -1;
+    }
+
+    hnsw_init(h, header.m, header.ef_construction, header.ef_search, distance, space);
+    h->rng = header.rng;
+    h->fingerprint = header.fingerprint;
+    if (reserve_nodes(h, header.num_nodes) != 0) {
+        fclose(f);
+        hnsw_free(h);
+        return -1;
+    }
+
+    int rc = 0;
+    for (size_t i = 0; i < header.num_nodes && rc == 0; i++) {
+        int32_t level;
+        if (fread(&level, sizeof(level), 1, f) != 1 || level < 0 || level > HNSW_MAX_LEVEL ||
+            alloc_node(h, &h->nodes[i], level) != 0) {
+            rc = -1;
+            break;
+        }
+        h->num_nodes++;
+        hnsw_node_t *n = &h->nodes[i];
+        size_t links = 2 * h->m + (size_t)level * h->m;
+        if (fread(n->count, sizeof(uint32_t), level + 1, f) != (size_t)level + 1 ||
+            fread(n->links, sizeof(uint32_t), links, f) != links) {
+            rc = -1;
+            break;
+        }
+        for (int l = 0; l <= level && rc == 0; l++) {
+            if (n->count[l] > level_capacity(h, l)) {
+                rc = -1;
+            }
+            for (uint32_t j = 0; j < n->count[l] && rc == 0; j++) {
+                if (level_links(h, n, l)[j] >= header.num_nodes) {
+                    rc = -1;
+                }
+            }
+        }
+    }
+    fclose(f);
+
+    if (rc != 0) {
+        fprintf(stderr, "Error: HNSW index %s is corrupted\n", path);
+        hnsw_free(h);
+        return -1;
+    }
+    h->entry = (uint32_t)header.entry;
+    h->max_level = (int)header.max_level;
+    return 0;
+}
+
+int knn_hnsw_neighborhood(const knn_model_t *model, hnsw_t *h, uint32_t user, size_t k,
+                          knn_neighborhood_t *nb)
+{
+    memset(nb, 0, sizeof(*nb));
+    nb->user = user;
+    if (model == NULL || user >= model->num_users || user >= h->num_nodes) {
+        return -1;
+    }
+    // k vient du client : jamais plus de voisins que d'autres users
+    if (k > model->num_users - 1) {
+        k = model->num_users - 1;
+    }
+    if (k == 0) {
+        return 0;
+    }
+
+    // Tout le faisceau est repris : la similarité du modèle (sur les items
+    // co-notés) ne classe pas exactement comme la distance de l'index
+    size_t pool = h->ef_search > k ? h->ef_search : k;
+    topn_t candidates, top;
+    if (topn_init(&candidates, pool) != 0) {
+        return -1;
+    }
+    if (topn_init(&top, k) != 0) {
+        topn_free(&candidates);
+        return -1;
+    }
+    if (hnsw_search(h, user, pool, &candidates) != 0) {
+        topn_free(&candidates);
+        topn_free(&top);
+        return -1;
+    }
+    size_t len = topn_finish(&candidates);
+    for (size_t i = 0; i < len; i++) {
+        uint32_t v = candidates.heap[i].id;
+        topn_push(&top, v, knn_model_similarity(model, user, v));
+    }
+    topn_free(&candidates);
+
+    nb->users = malloc(k * sizeof(uint32_t));
+    nb->similarity = malloc(k * sizeof(double));
+    if (nb->users == NULL || nb->similarity == NULL) {
+        knn_neighborhood_free(nb);
+        topn_free(&top);
+        return -1;
+    }
+    nb->len = topn_finish(&top);
+    for (size_t i = 0; i < nb->len; i++) {
+        nb->users[i] = top.heap[i].id;
+        nb->similarity[i] = top.heap[i].score;
+    }
+    topn_free(&top);
+    return 0;
+}
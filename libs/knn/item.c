@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "knn.h"
+
+void item_knn_free(item_knn_t *index)
+{
+    if (index == NULL) {
+        return;
+    }
+    free(index->neighbors);
+    free(index->scores);
+    memset(index, 0, sizeof(*index));
+}
+
+int item_knn_build(item_knn_t *index, const rating_store_t *store, size_t m, similarity_kind_t kind)
+{
+    memset(index, 0, sizeof(*index));
+    index->num_items = store->num_items;
+    index->m = m ? m : 1;
+    index->similarity = kind;
+
+    size_t n_items = store->num_items;
+    size_t n_users = store->num_users;
+    size_t cells = n_items * index->m;
+    index->neighbors = malloc((cells ? cells : 1) * sizeof(uint32_t));
+    index->scores = malloc((cells ? cells : 1) * sizeof(float));
+
+    // Accumulateurs d'une ligne : statistiques par item co-noté + liste des items touchés
+    similarity_stats_t *stats = calloc(n_items ? n_items : 1, sizeof(similarity_stats_t));
+    uint32_t *touched = malloc((n_items ? n_items : 1) * sizeof(uint32_t));
+    float *user_mean = calloc(n_users ? n_users : 1, sizeof(float));
+    topn_t top = {0};
+    if (!index->neighbors || !index->scores || !stats || !touched || !user_mean ||
+        topn_init(&top, index->m) != 0) {
+        free(stats);
+        free(touched);
+        free(user_mean);
+        item_knn_free(index);
+        return -1;
+    }
+
+    // Centre du cosinus ajusté : moyenne de chaque user
+    for (size_t u = 0; u < n_users; u++) {
+        const uint32_t *items;
+        const uint8_t *values;
+        size_t len = store_user_profile(store, u, &items, &values);
+        double sum = 0.0;
+        for (size_t e = 0; e < len; e++) {
+            sum += values[e] / 10.0;
+        }
+        user_mean[u] = len ? (float)(sum / len) : 0.0f;
+    }
+
+    for (size_t i = 0; i < n_items; i++) {
+        // Produit creux colonne i (CSC) x lignes (CSR) : seuls les items
+        // co-notés avec i sont visités
+        const uint32_t *raters;
+        const uint8_t *ratings_i;
+        size_t n_raters = store_item_profile(store, i, &raters, &ratings_i);
+        size_t n_touched = 0;
+
+        for (size_t r = 0; r < n_raters; r++) {
+            uint32_t u = raters[r];
+            double c = (kind == SIM_ADJUSTED_COSINE) ? user_mean[u] : 0.0;
+            double x = ratings_i[r] / 10.0 - c;
+
+            const uint32_t *items;
+            const uint8_t *values;
+            size_t len = store_user_profile(store, u, &items, &values);
+            for (size_t e = 0; e < len; e++) {
+                uint32_t j = items[e];
+                if (j == i) {
+                    continue;
+                }
+                similarity_stats_t *s = &stats[j];
+                if (s->count == 0) {
+                    touched[n_touched++] = j;
+                }
+                double y = values[e] / 10.0 - c;
+                s->sum_x += x;
+                s->sum_y += y;
+                s->sum_xx += x * x;
+                s->sum_yy += y * y;
+                s->sum_xy += x * y;
+                s->count++;
+            }
+        }
+
+        // Garder les M voisins les plus similaires (similarité positive)
+        for (size_t t = 0; t < n_touched; t++) {
+            uint32_t j = touched[t];
+            double sim = (kind == SIM_PEARSON) ? similarity_pearson(&stats[j]) : similarity_cosine(&stats[j]);
+            if (sim > 0.0) {
+                topn_push(&top, j, sim);
+            }
+            memset(&stats[j], 0, sizeof(similarity_stats_t));
+        }
+
+        size_t len = topn_finish(&top);
+        uint32_t *ids = index->neighbors + i * index->m;
+        float *scores = index->scores + i * index->m;
+        for (size_t j = 0; j < index->m; j++) {
+            ids[j] = j < len ? top.heap[j].id : KNN_TABLE_NONE;
+            scores[j] = j < len ? (float)top.heap[j].score : 0.0f;
+        }
+    }
+
+    topn_free(&top);
+    free(stats);
+    free(touched);
+    free(user_mean);
+    return 0;
+}
+
+int item_knn_load(item_knn_t *index, const char *path)
+{
+    memset(index, 0, sizeof(*index));
+    allpairs_header_t header;
+    uint32_t *neighbors;
+    float *scores;
+    if (allpairs_load(path, &header, &neighbors, &scores) != 0) {
+        return -1;
+    }
+    if (header.side != ALLPAIRS_ITEMS) {
+        fprintf(stderr, "Error: %s is not an item-item table\n", path);
+        free(neighbors);
+        free(scores);
+        return -1;
+    }
+
+    // Lignes triées par score décroissant : la première similarité non
+    // positive termine la ligne
+    for (size_t i = 0; i < header.num_rows; i++) {
+        for (size_t j = 0; j < header.m; j++) {
+            size_t e = i * header.m + j;
+            if (neighbors[e] == KNN_TABLE_NONE || scores[e] <= 0.0f) {
+                neighbors[e] = KNN_TABLE_NONE;
+                scores[e] = 0.0f;
+            }
+        }
+    }
+    index->num_items = header.num_rows;
+    index->m = header.m;
+    index->neighbors = neighbors;
+    index->scores = scores;
+    index->similarity = (similarity_kind_t)header.similarity;
+    index->fingerprint = header.fingerprint;
+    return 0;
+}
+
+int item_knn_rank(const item_knn_t *index, const uint32_t *items, const float *ratings, size_t len, topn_t *top)
+{
+    size_t n_items = index->num_items;
+    double *weighted_sum = calloc(n_items ? n_items : 1, sizeof(double));
+    double *similarity_sum = calloc(n_items ? n_items : 1, sizeof(double));
+    uint32_t *touched = malloc((n_items ? n_items : 1) * sizeof(uint32_t));
+    if (weighted_sum == NULL || similarity_sum == NULL || touched == NULL) {
+        free(weighted_sum);
+        free(similarity_sum);
+        free(touched);
+        return -1;
+    }
+
+    // O(len x M) : chaque item noté propage sa note à ses M voisins
+    size_t n_touched = 0;
+    for (size_t e = 0; e < len; e++) {
+        if (items[e] >= n_items) {
+            continue;
+        }
+        const uint32_t *ids = index->neighbors + (size_t)items[e] * index->m;
+        const float *scores = index->scores + (size_t)items[e] * index->m;
+        for (size_t j = 0; j < index->m && ids[j] != KNN_TABLE_NONE; j++) {
+            if (similarity_sum[ids[j]] == 0.0) {
+                touched[n_touched++] = ids[j];
+            }
+            weighted_sum[ids[j]] += scores[j] * ratings[e];
+            similarity_sum[ids[j]] += scores[j];
+        }
+    }
+
+    // Les items déjà notés (profil trié) ne sont pas candidats
+    for (size_t t = 0; t < n_touched; t++) {
+        uint32_t j = touched[t];
+        size_t lo = 0, hi = len;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (items[mid] < j) lo = mid + 1; else hi = mid;
+        }
+        if ((lo < len && items[lo] == j) || similarity_sum[j] < 0.001) {
+            continue;
+        }
+        topn_push(top, j, weighted_sum[j] / similarity_sum[j]);
+    }
+
+    free(weighted_sum);
+    free(similarity_sum);
+    free(touched);
+    return 0;
+}
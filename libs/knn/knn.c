@@ -4,6 +4,8 @@
 #include <ndmath/all.h>
 
 #include <math.h>
+#include <core/kernels.h>
+#include <core/topn.h>
 #include "knn.h"
 
 knn_t* init_knn(size_t k)
@@ -15,6 +17,7 @@ knn_t* init_knn(size_t k)
     KNN->k = k;  
     KNN->X = NULL;
     KNN->y = NULL;
+    KNN->pool = NULL;
     return KNN; 
 }
 
@@ -61,30 +64,18 @@ knn_t * fit(knn_t *model, ndarray_t X, ndarray_t y)
 }
 
 
-// Calculate Pearson correlation coefficient between two users/items
+// Calculate Pearson correlation coefficient between two users/items.
+// Rows are contiguous, so the sums over co-rated items come from one
+// vectorized pass (core/kernels.h).
 double pearson_correlation(ndarray_t user1, ndarray_t user2)
 {
     int n = user1.shape[1]; // number of items
-    double sum_x = 0.0, sum_y = 0.0;
-    double sum_x2 = 0.0, sum_y2 = 0.0;
-    double sum_xy = 0.0;
-    int count = 0;
     
-    // Calculate sums for items that both users have rated (non-zero values)
-    for (int i = 0; i < n; i++) {
-        double x = get(&user1, 0, i);
-        double y = get(&user2, 0, i);
-        
-        // Only consider items that both users have rated (assuming 0 means not rated)
-        if (x > 0.001 && y > 0.001) { // Use small epsilon instead of exact 0.0
-            sum_x += x;
-            sum_y += y;
-            sum_x2 += x * x;
-            sum_y2 += y * y;
-            sum_xy += x * y;
-            count++;
-        }
-    }
+    // Sums over items that both users have rated (0 means not rated,
+    // compared against a small epsilon instead of exact 0.0)
+    kernel_stats_t stats;
+    kernel_masked_stats(user1.data[0], user2.data[0], n, 0.001, &stats);
+    size_t count = stats.count;
     
     // Need at least 1 common rating to calculate correlation (relaxed requirement)
     if (count < 1) {
@@ -96,13 +87,13 @@ double pearson_correlation(ndarray_t user1, ndarray_t user2)
     }
     
     // Calculate means
-    double mean_x = sum_x / count;
-    double mean_y = sum_y / count;
+    double mean_x = stats.sum_x / count;
+    double mean_y = stats.sum_y / count;
     
     // Calculate Pearson correlation coefficient
-    double numerator = sum_xy - count * mean_x * mean_y;
-    double denominator_x = sum_x2 - count * mean_x * mean_x;
-    double denominator_y = sum_y2 - count * mean_y * mean_y;
+    double numerator = stats.sum_xy - count * mean_x * mean_y;
+    double denominator_x = stats.sum_xx - count * mean_x * mean_x;
+    double denominator_y = stats.sum_yy - count * mean_y * mean_y;
     
     double denominator = sqrt(denominator_x * denominator_y);
     
@@ -122,23 +113,12 @@ double pearson_correlation(ndarray_t user1, ndarray_t user2)
 double pearson_correlation_centered(ndarray_t user1, ndarray_t user2)
 {
     int n = user1.shape[1];
-    double sum_numerator = 0.0;
-    double sum_denom_x = 0.0;
-    double sum_denom_y = 0.0;
-    int count = 0;
     
-    // First pass: calculate means for commonly rated items
-    double sum_x = 0.0, sum_y = 0.0;
-    for (int i = 0; i < n; i++) {
-        double x = get(&user1, 0, i);
-        double y = get(&user2, 0, i);
-        
-        if (x > 0.001 && y > 0.001) { // Use epsilon comparison
-            sum_x += x;
-            sum_y += y;
-            count++;
-        }
-    }
+    // Single pass over commonly rated items; the centered sums are derived
+    // from the raw ones instead of a second pass
+    kernel_stats_t stats;
+    kernel_masked_stats(user1.data[0], user2.data[0], n, 0.001, &stats);
+    size_t count = stats.count;
     
     if (count < 1) {
         return 0.0;
@@ -149,24 +129,13 @@ double pearson_correlation_centered(ndarray_t user1, ndarray_t user2)
         return 0.2;
     }
     
-    double mean_x = sum_x / count;
-    double mean_y = sum_y / count;
-    
-    // Second pass: calculate correlation using mean-centered values
-    for (int i = 0; i < n; i++) {
-        double x = get(&user1, 0, i);
-        double y = get(&user2, 0, i);
-        
-        if (x > 0.001 && y > 0.001) {
-            double centered_x = x - mean_x;
-            double centered_y = y - mean_y;
-            
-            sum_numerator += centered_x * centered_y;
-            sum_denom_x += centered_x * centered_x;
-            sum_denom_y += centered_y * centered_y;
-        }
-    }
-    
+    // sum((x - mean_x) * (y - mean_y)) = sum_xy - sum_x * sum_y / count, etc.
+    double sum_numerator = stats.sum_xy - stats.sum_x * stats.sum_y / count;
+    double sum_denom_x = stats.sum_xx - stats.sum_x * stats.sum_x / count;
+    double sum_denom_y = stats.sum_yy - stats.sum_y * stats.sum_y / count;
+    if (sum_denom_x < 0.0) sum_denom_x = 0.0; // rounding on constant ratings
+    if (sum_denom_y < 0.0) sum_denom_y = 0.0;
+
     double denominator = sqrt(sum_denom_x * sum_denom_y);
     
     if (denominator < 0.001) {
@@ -196,67 +165,109 @@ void swap_double(double *a, double *b)
     *b = temp;
 }
 
+// Sorts arr in descending order (ties keep index order) and returns the
+// original index of each sorted entry
 int *arg_bubble_sort_desc(double *arr, int n)
 {
-    int *arg = calloc(n, sizeof(int));
-    if (arg == NULL) {
+    int *arg = calloc(n > 0 ? n : 1, sizeof(int));
+    scored_id_t *ranked = malloc((n > 0 ? n : 1) * sizeof(scored_id_t));
+    if (arg == NULL || ranked == NULL) {
+        free(arg);
+        free(ranked);
         return NULL;
     }
     
     for(int i = 0; i < n; i++) {
-        arg[i] = i;
+        ranked[i].id = i;
+        ranked[i].score = arr[i];
     }
 
-    for(int i = 0; i < n - 1; i++) {
-        for(int j = 0; j < n - 1 - i; j++) {
-            if(arr[j] < arr[j + 1]) { // Changed to descending order
-                swap_int(&arg[j], &arg[j + 1]);
-                swap_double(&arr[j], &arr[j + 1]);
-            }
-        }    
+    topn_select(ranked, n, n);
+
+    for(int i = 0; i < n; i++) {
+        arg[i] = ranked[i].id;
+        arr[i] = ranked[i].score;
     }
 
+    free(ranked);
     return arg;
 }
 
-// Predict rating for a specific item using collaborative filtering
-double predict_rating(knn_t *model, int user_idx, int item_idx)
+// Correlations of a slice of users with the target user
+typedef struct {
+    knn_t *model;
+    int user_idx;
+    ndarray_t target_user;
+    double *correlations;
+} correlation_scan_t;
+
+static void correlate_users(void *arg, size_t begin, size_t end, size_t worker)
 {
-    if (model == NULL || model->X == NULL) {
-        return 0.0;
+    correlation_scan_t *scan = arg;
+    (void)worker;
+    for (size_t i = begin; i < end; i++) {
+        if ((int)i == scan->user_idx) {
+            scan->correlations[i] = -2.0; // Exclude self with very low value
+        } else {
+            ndarray_t other_user = row_index(scan->model->X, i);
+            scan->correlations[i] = pearson_correlation_centered(scan->target_user, other_user);
+        }
     }
-    
+}
+
+// Compute the similarity of user_idx with every user once and keep the
+// model->k best in descending order. correlations[i] is the similarity of
+// similar_users[i].
+static int *dense_neighborhood(knn_t *model, int user_idx, double **correlations_out)
+{
     int n_users = model->X->shape[0];
     ndarray_t target_user = row_index(model->X, user_idx);
     
-    // Calculate correlations with all other users
     double *correlations = malloc(n_users * sizeof(double));
     if (correlations == NULL) {
-        return 0.0;
+        return NULL;
     }
     
-    for (int i = 0; i < n_users; i++) {
-        if (i == user_idx) {
-            correlations[i] = -2.0; // Exclude self with very low value
-        } else {
-            ndarray_t other_user = row_index(model->X, i);
-            correlations[i] = pearson_correlation_centered(target_user, other_user);
-        }
-    }
+    // Each worker fills its own slice of correlations
+    correlation_scan_t scan = { model, user_idx, target_user, correlations };
+    pool_parallel_for(model->pool, n_users, KNN_SCAN_GRAIN, correlate_users, &scan);
     
-    // Get k most similar users (highest correlation)
-    int *similar_users = arg_bubble_sort_desc(correlations, n_users);
-    if (similar_users == NULL) {
+    // Only the first k entries are read: select them, O(n_users log k)
+    size_t k = model->k < (size_t)n_users ? model->k : (size_t)n_users;
+    scored_id_t *ranked = malloc((n_users > 0 ? n_users : 1) * sizeof(scored_id_t));
+    int *similar_users = malloc((k > 0 ? k : 1) * sizeof(int));
+    if (ranked == NULL || similar_users == NULL) {
+        free(ranked);
+        free(similar_users);
         free(correlations);
-        return 0.0;
+        return NULL;
+    }
+    for (int i = 0; i < n_users; i++) {
+        ranked[i].id = i;
+        ranked[i].score = correlations[i];
     }
+    topn_select(ranked, n_users, k);
+    for (size_t i = 0; i < k; i++) {
+        similar_users[i] = ranked[i].id;
+        correlations[i] = ranked[i].score;
+    }
+    free(ranked);
+    
+    *correlations_out = correlations;
+    return similar_users;
+}
+
+// Predict one item from a precomputed neighborhood
+static double predict_from_neighborhood(knn_t *model, int user_idx, int item_idx,
+                                        const int *similar_users, const double *correlations)
+{
+    size_t n_users = model->X->shape[0];
     
     // Calculate weighted average rating
     double weighted_sum = 0.0;
     double correlation_sum = 0.0;
     int count = 0;
     
-    // Try to use users with positive correlation first
     for (size_t i = 0; i < model->k && i < n_users; i++) {
         int similar_user_idx = similar_users[i];
         
@@ -265,7 +276,7 @@ double predict_rating(knn_t *model, int user_idx, int item_idx)
             continue;
         }
         
-        double correlation = correlations[similar_user_idx];
+        double correlation = correlations[i];
         
         // Get the rating of this similar user for the target item
         double rating = get(model->X, similar_user_idx, item_idx);
@@ -288,7 +299,7 @@ double predict_rating(knn_t *model, int user_idx, int item_idx)
         double item_sum = 0.0;
         int item_count = 0;
         
-        for (int u = 0; u < n_users; u++) {
+        for (size_t u = 0; u < n_users; u++) {
             double rating = get(model->X, u, item_idx);
             if (rating > 0.001) {
                 item_sum += rating;
@@ -297,10 +308,7 @@ double predict_rating(knn_t *model, int user_idx, int item_idx)
         }
         
         if (item_count > 0) {
-            double item_avg = item_sum / item_count;
-            free(correlations);
-            free(similar_users);
-            return item_avg;
+            return item_sum / item_count;
         }
         
         // Last resort: use user's average rating
@@ -315,15 +323,31 @@ double predict_rating(knn_t *model, int user_idx, int item_idx)
             }
         }
         
-        free(correlations);
-        free(similar_users);
         return user_count > 0 ? user_sum / user_count : 2.5; // Default to middle rating
     }
     
+    return weighted_sum / correlation_sum;
+}
+
+// Predict rating for a specific item using collaborative filtering
+double predict_rating(knn_t *model, int user_idx, int item_idx)
+{
+    if (model == NULL || model->X == NULL) {
+        return 0.0;
+    }
+    
+    double *correlations;
+    int *similar_users = dense_neighborhood(model, user_idx, &correlations);
+    if (similar_users == NULL) {
+        return 0.0;
+    }
+    
+    double prediction = predict_from_neighborhood(model, user_idx, item_idx, similar_users, correlations);
+    
     free(correlations);
     free(similar_users);
     
-    return weighted_sum / correlation_sum;
+    return prediction;
 }
 
 // Modified predict function for collaborative filtering
@@ -354,17 +378,28 @@ ndarray_t predict_all_items(knn_t *model, int user_idx)
     int n_items = model->X->shape[1];
     ndarray_t predictions = array(1, n_items);
     
+    // Neighborhood computed once for all items
+    double *correlations;
+    int *similar_users = dense_neighborhood(model, user_idx, &correlations);
+    if (similar_users == NULL) {
+        return predictions;
+    }
+    
     for (int item_idx = 0; item_idx < n_items; item_idx++) {
         double existing_rating = get(model->X, user_idx, item_idx);
         
         if (existing_rating == 0.0) {
-            double predicted_rating = predict_rating(model, user_idx, item_idx);
+            double predicted_rating = predict_from_neighborhood(model, user_idx, item_idx,
+                                                                similar_users, correlations);
             set(&predictions, 0, item_idx, predicted_rating);
         } else {
             set(&predictions, 0, item_idx, existing_rating);
         }
     }
     
+    free(correlations);
+    free(similar_users);
+    
     return predictions;
 }
 
@@ -2,13 +2,173 @@
 #define KNN_H
 
 #include <ndmath/ndarray.h>
+#include <core/store.h>
+#include <core/topn.h>
+#include <core/pool.h>
+
+// Tranche de users traitée d'un bloc par un worker lors d'un balayage
+#define KNN_SCAN_GRAIN 1024
 
 typedef struct KNN{
     size_t k;
     ndarray_t *X;
     ndarray_t *y;
+    thread_pool_t *pool;     // optionnel : parallélise le calcul des corrélations
 }knn_t;
 
+// Vecteur creux : indices triés par ordre croissant et valeurs associées
+typedef struct SparseVector {
+    const uint32_t *index;
+    const float *value;
+    size_t len;
+} sparse_vector_t;
+
+// Statistiques suffisantes sur l'intersection de deux vecteurs creux
+typedef struct SimilarityStats {
+    size_t count;
+    double sum_x, sum_y;
+    double sum_xx, sum_yy;
+    double sum_xy;
+} similarity_stats_t;
+
+typedef enum {
+    SIM_PEARSON,             // Pearson centré sur les indices communs
+    SIM_COSINE,              // cosinus sur les indices communs
+    SIM_ADJUSTED_COSINE      // cosinus après soustraction de center[indice]
+} similarity_kind_t;
+
+// Profil creux d'un user : items triés par ordre croissant
+typedef struct KNNProfile {
+    uint32_t *items;
+    float *ratings;
+    size_t len;
+    size_t cap;
+    double sum;              // somme des notes (moyenne du user)
+    double sum_sq;           // somme des carrés (norme du profil centré)
+} knn_profile_t;
+
+// Users ayant noté un item, dans l'ordre d'arrivée
+typedef struct KNNRaters {
+    uint32_t *users;
+    size_t len;
+    size_t cap;
+} knn_raters_t;
+
+// Modèle KNN persistant, construit une fois à partir du store puis mis à
+// jour rating par rating. Une requête ne fait que du scoring.
+typedef struct KNNModel {
+    size_t num_users;
+    size_t num_items;
+    knn_profile_t *profiles; // num_users profils
+    size_t cap_users;
+    double *item_sum;        // somme et nombre de notes par item (moyenne de repli)
+    uint32_t *item_count;
+    float *item_mean;        // centre du cosinus ajusté entre users
+    knn_raters_t *raters;    // users de chaque item (lignes de table touchées par une note)
+    size_t cap_items;
+    similarity_kind_t similarity;
+    thread_pool_t *pool;     // optionnel (NULL = séquentiel) : balayages de users en parallèle
+} knn_model_t;
+
+// Voisinage d'un user : ses k voisins les plus corrélés, calculés une fois
+// et réutilisés pour scorer tous les items candidats
+typedef struct KNNNeighborhood {
+    uint32_t user;
+    size_t len;
+    uint32_t *users;         // similarité décroissante (à égalité, index croissant)
+    double *similarity;
+} knn_neighborhood_t;
+
+#define KNN_TABLE_MAGIC "RECKNN2"
+#define KNN_TABLE_NONE UINT32_MAX
+
+// Table précalculée des K meilleurs voisins de chaque user (ids + scores
+// float32, ligne u = [u * k, (u + 1) * k)). Une ligne marquée stale est
+// recalculée à la demande ; add_rating() ne marque que les lignes touchées.
+typedef struct KNNTable {
+    size_t num_users;
+    size_t k;
+    uint32_t *neighbors;     // KNN_TABLE_NONE pour les cases vides
+    float *scores;
+    uint8_t *stale;
+    size_t cap_users;
+    uint64_t fingerprint;    // dataset_fingerprint() des données du calcul (contrôle au chargement)
+} knn_table_t;
+
+// Index item-item : les M items les plus similaires de chaque item
+// (similarités positives en float32), ligne i = [i * m, (i + 1) * m)
+typedef struct ItemKNN {
+    size_t num_items;
+    size_t m;
+    uint32_t *neighbors;     // KNN_TABLE_NONE pour les cases vides
+    float *scores;
+    similarity_kind_t similarity;
+    uint64_t fingerprint;    // empreinte des données si chargé depuis un fichier, sinon 0
+} item_knn_t;
+
+#define ALLPAIRS_MAGIC "RECPAI2"
+#define ALLPAIRS_BLOCK_ROWS 4096
+
+typedef enum {
+    ALLPAIRS_USERS,          // user-user (lignes CSR)
+    ALLPAIRS_ITEMS           // item-item (lignes CSC)
+} allpairs_side_t;
+
+// Paramètres du calcul tous-contre-tous
+typedef struct AllPairsOptions {
+    allpairs_side_t side;
+    similarity_kind_t similarity;  // PEARSON : centrage par ligne, ADJUSTED_COSINE : par colonne
+    size_t m;                      // voisins gardés par ligne
+    size_t block_rows;             // lignes calculées puis écrites ensemble (0 = ALLPAIRS_BLOCK_ROWS)
+    thread_pool_t *pool;           // optionnel
+    uint64_t fingerprint;          // empreinte des données, recopiée dans l'en-tête
+} allpairs_options_t;
+
+// En-tête du fichier : suivi de num_rows x m voisins (uint32, KNN_TABLE_NONE
+// pour les cases vides) puis num_rows x m scores (float), ligne par ligne
+typedef struct AllPairsHeader {
+    char magic[8];
+    uint32_t side;
+    uint32_t similarity;
+    uint64_t num_rows;
+    uint64_t m;
+    uint64_t nnz;                  // notes du store au moment du calcul
+    uint64_t fingerprint;          // dataset_fingerprint() des données du calcul
+} allpairs_header_t;
+
+#define HNSW_MAGIC "RECHNS2"
+
+// Distance entre deux vecteurs d'un espace opaque (par ex. knn_model_distance)
+typedef float (*hnsw_distance_t)(const void *space, uint32_t a, uint32_t b);
+
+// Noeud du graphe : 2M liens au niveau 0, puis M liens par niveau supérieur,
+// dans un seul tableau
+typedef struct HNSWNode {
+    int level;
+    uint32_t *count;         // count[l] : nombre de liens au niveau l
+    uint32_t *links;
+} hnsw_node_t;
+
+// Index HNSW (Hierarchical Navigable Small World) : voisins approchés en
+// O(log n) distances par requête au lieu d'un balayage de tous les users.
+// Les noeuds sont les ids 0..num_nodes-1 de l'espace.
+typedef struct HNSW {
+    size_t m;                // liens par noeud et par niveau
+    size_t ef_construction;  // largeur du faisceau à l'insertion
+    size_t ef_search;        // largeur du faisceau à la recherche (rappel / latence)
+    hnsw_distance_t distance;
+    const void *space;
+    hnsw_node_t *nodes;
+    size_t num_nodes;
+    size_t cap_nodes;
+    uint32_t entry;
+    int max_level;           // -1 si l'index est vide
+    uint64_t rng;
+    uint32_t *visited;       // marques de visite par époque (pas de remise à zéro)
+    uint32_t epoch;
+    uint64_t fingerprint;    // empreinte des données de l'espace (contrôle au chargement)
+} hnsw_t;
+
 
 extern knn_t * init_knn(size_t k);
 
@@ -19,12 +179,132 @@ extern knn_t * fit(knn_t *model, ndarray_t X, ndarray_t y);
 
 extern double pearson_correlation(ndarray_t user1, ndarray_t user2);
 extern double pearson_correlation_centered(ndarray_t user1, ndarray_t user2);
+
+// Noyaux creux : une seule passe sur l'intersection (fusion, ou recherche
+// galopante si une liste est beaucoup plus courte), coût proportionnel à la
+// longueur des profils et non à la taille du catalogue
+extern void sparse_similarity_stats(sparse_vector_t a, sparse_vector_t b, const float *center,
+                                    similarity_stats_t *stats);
+extern double similarity_pearson(const similarity_stats_t *stats);
+extern double similarity_cosine(const similarity_stats_t *stats);
+extern double sparse_pearson_centered(sparse_vector_t a, sparse_vector_t b);
+extern double sparse_cosine(sparse_vector_t a, sparse_vector_t b);
+extern double sparse_adjusted_cosine(sparse_vector_t a, sparse_vector_t b, const float *center);
+extern double sparse_similarity(similarity_kind_t kind, sparse_vector_t a, sparse_vector_t b, const float *center);
 extern int *arg_bubble_sort_desc(double *arr, int n);
 extern double predict_rating(knn_t *model, int user_idx, int item_idx);
 extern ndarray_t predict(knn_t *model, ndarray_t user_item_pairs);
 
 extern ndarray_t predict_all_items(knn_t *model, int user_idx);
 extern void free_knn(knn_t *model);
+
+extern knn_model_t *knn_model_build(const rating_store_t *store);
+extern void knn_model_free(knn_model_t *model);
+
+// Ajoute ou remplace la note (0-5) de user pour item ; agrandit le modèle si besoin.
+// Retourne 0 en cas de succès, -1 en cas d'échec d'allocation.
+extern int knn_model_add_rating(knn_model_t *model, uint32_t user, uint32_t item, double rating);
+
+// Retourne la note de user pour item, ou -1.0 s'il ne l'a pas noté
+extern double knn_model_rating(const knn_model_t *model, uint32_t user, uint32_t item);
+extern double knn_model_similarity(const knn_model_t *model, uint32_t user1, uint32_t user2);
+
+// Distance cosinus entre profils centrés et normalisés, dans [0, 2].
+// space est le knn_model_t (signature de hnsw_distance_t).
+extern float knn_model_distance(const void *space, uint32_t user1, uint32_t user2);
+
+// Calcule les similarités de user avec tous les autres users et garde les
+// k meilleures (réparties entre les workers de model->pool, chacun avec son
+// propre tas, fusionnés à la fin). Retourne 0 en cas de succès, -1 sinon.
+extern int knn_model_neighborhood(const knn_model_t *model, uint32_t user, size_t k, knn_neighborhood_t *nb);
+extern void knn_neighborhood_free(knn_neighborhood_t *nb);
+
+// Moyenne des notes des voisins ayant noté item, pondérée par |corrélation|,
+// avec repli sur la moyenne de l'item puis celle du user
+extern double knn_neighborhood_predict(const knn_model_t *model, const knn_neighborhood_t *nb, uint32_t item);
+
+// Classe tous les items non notés par nb->user selon knn_neighborhood_predict(),
+// en un seul balayage des profils des voisins : O(somme des profils + items).
+// top doit avoir été initialisé avec le nombre de résultats voulu.
+// Retourne 0 en cas de succès, -1 en cas d'échec d'allocation.
+extern int knn_neighborhood_rank(const knn_model_t *model, const knn_neighborhood_t *nb, topn_t *top);
+
+// Prédiction isolée : voisinage + knn_neighborhood_predict(). Pour plusieurs
+// items d'un même user, calculer le voisinage une seule fois.
+extern double knn_model_predict(const knn_model_t *model, size_t k, uint32_t user, uint32_t item);
+
+// Table vide de num_users lignes, toutes à calculer. Retourne 0 ou -1.
+extern int knn_table_init(knn_table_t *table, size_t num_users, size_t k);
+extern void knn_table_free(knn_table_t *table);
+
+// Calcule toutes les lignes en attente (O(users^2 x profil), job hors ligne),
+// une ligne par tâche sur model->pool
+extern int knn_table_build(knn_table_t *table, const knn_model_t *model);
+extern int knn_table_refresh_row(knn_table_t *table, const knn_model_t *model, uint32_t user);
+
+// À appeler après knn_model_add_rating(model, user, item, ...) : la ligne de
+// user est à recalculer, celles des autres users ayant noté item sont
+// corrigées en place (ou marquées si user sort de leur top K). Coût
+// proportionnel au nombre de notes de item, pas au nombre de users.
+extern int knn_table_update(knn_table_t *table, const knn_model_t *model, uint32_t user, uint32_t item);
+
+// Voisinage de user limité à k <= table->k voisins, ligne recalculée si besoin
+extern int knn_table_neighborhood(knn_table_t *table, const knn_model_t *model, uint32_t user,
+                                  size_t k, knn_neighborhood_t *nb);
+
+// Construit l'index à partir des vues CSC/CSR du store, en ne visitant que
+// les paires d'items co-notées. Retourne 0 en cas de succès, -1 sinon.
+extern int item_knn_build(item_knn_t *index, const rating_store_t *store, size_t m, similarity_kind_t kind);
+
+// Charge une table item-item écrite par allpairs_build() (côté items) :
+// seules les similarités positives sont gardées, comme dans item_knn_build().
+// L'appelant compare index->fingerprint à ses données. Retourne 0 ou -1.
+extern int item_knn_load(item_knn_t *index, const char *path);
+extern void item_knn_free(item_knn_t *index);
+
+// Score de chaque item voisin d'un item du profil (items triés, notes 0-5) :
+// moyenne des notes du profil pondérée par la similarité. Coût O(len x M),
+// indépendant du nombre de users. Les items du profil sont exclus.
+extern int item_knn_rank(const item_knn_t *index, const uint32_t *items, const float *ratings,
+                         size_t len, topn_t *top);
+
+extern int hnsw_init(hnsw_t *h, size_t m, size_t ef_construction, size_t ef_search,
+                     hnsw_distance_t distance, const void *space);
+extern void hnsw_free(hnsw_t *h);
+
+// Ajoute le noeud node, qui doit valoir h->num_nodes. Retourne 0 ou -1.
+extern int hnsw_insert(hnsw_t *h, uint32_t node);
+
+// Recalcule les liens de node après une modification de son vecteur
+extern int hnsw_update(hnsw_t *h, uint32_t node);
+
+// Ajoute à out les k plus proches voisins approchés de query (query exclu),
+// avec score = 1 - distance. Non réentrant : h garde l'état des visites.
+extern int hnsw_search(hnsw_t *h, uint32_t query, size_t k, topn_t *out);
+
+// L'espace n'est pas sauvegardé : il est fourni à nouveau au chargement
+extern int hnsw_save(const hnsw_t *h, const char *path);
+extern int hnsw_load(hnsw_t *h, const char *path, hnsw_distance_t distance, const void *space);
+
+// Source de voisins alternative à knn_model_neighborhood() : candidats
+// fournis par l'index (construit sur knn_model_distance), puis pondérés par
+// knn_model_similarity() comme un voisinage exact
+extern int knn_hnsw_neighborhood(const knn_model_t *model, hnsw_t *h, uint32_t user, size_t k,
+                                 knn_neighborhood_t *nb);
+
+// Table des M plus proches voisins de chaque ligne, par similarité cosinus
+// des lignes normalisées (centrées selon options->similarity) sur tout leur
+// profil. Produit creux A x A^T calculé par blocs de lignes en parallèle :
+// chaque bloc terminé est écrit dans path, la mémoire ne dépend que de nnz,
+// de la taille des blocs et du nombre de workers. Retourne 0 ou -1.
+extern int allpairs_build(const rating_store_t *store, const allpairs_options_t *options, const char *path);
+
+// Lit une table écrite par allpairs_build() (tableaux à libérer avec free) ;
+// les voisins sont vérifiés dans les bornes de la table
+extern int allpairs_load(const char *path, allpairs_header_t *header, uint32_t **neighbors, float **scores);
+
+extern int knn_table_save(const knn_table_t *table, const char *path);
+extern int knn_table_load(knn_table_t *table, const char *path);
 extern ndarray_t generate_iris_like_data(int n_samples);
 extern ndarray_t generate_labels(int n_samples);
 extern void _train_test_split(ndarray_t X, ndarray_t y, double test_size,
@@ -0,0 +1,465 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <core/topn.h>
+
+#include "knn.h"
+
+knn_model_t *knn_model_build(const rating_store_t *store)
+{
+    knn_model_t *model = calloc(1, sizeof(knn_model_t));
+    if (model == NULL) {
+        return NULL;
+    }
+
+    size_t num_users = store->num_users;
+    size_t num_items = store->num_items;
+    model->cap_users = num_users ? num_users : 16;
+    model->cap_items = num_items ? num_items : 16;
+    model->profiles = calloc(model->cap_users, sizeof(knn_profile_t));
+    model->item_sum = calloc(model->cap_items, sizeof(double));
+    model->item_count = calloc(model->cap_items, sizeof(uint32_t));
+    model->item_mean = calloc(model->cap_items, sizeof(float));
+    model->raters = calloc(model->cap_items, sizeof(knn_raters_t));
+    if (!model->profiles || !model->item_sum || !model->item_count || !model->item_mean || !model->raters) {
+        knn_model_free(model);
+        return NULL;
+    }
+    model->num_users = num_users;
+    model->num_items = num_items;
+
+    // Les lignes CSR sont déjà triées et dédoublonnées : copie directe
+    for (size_t u = 0; u < num_users; u++) {
+        const uint32_t *items;
+        const uint8_t *values;
+        size_t len = store_user_profile(store, u, &items, &values);
+        knn_profile_t *p = &model->profiles[u];
+
+        if (len == 0) {
+            continue;
+        }
+        p->items = malloc(len * sizeof(uint32_t));
+        p->ratings = malloc(len * sizeof(float));
+        if (p->items == NULL || p->ratings == NULL) {
+            knn_model_free(model);
+            return NULL;
+        }
+        p->len = p->cap = len;
+
+        memcpy(p->items, items, len * sizeof(uint32_t));
+        for (size_t e = 0; e < len; e++) {
+            p->ratings[e] = values[e] / 10.0f;
+            p->sum += p->ratings[e];
+            p->sum_sq += p->ratings[e] * p->ratings[e];
+            model->item_sum[items[e]] += p->ratings[e];
+            model->item_count[items[e]]++;
+        }
+    }
+    for (size_t i = 0; i < num_items; i++) {
+        model->item_mean[i] = model->item_count[i] ? model->item_sum[i] / model->item_count[i] : 0.0f;
+    }
+
+    // Colonnes CSC : users de chaque item
+    for (size_t i = 0; i < num_items; i++) {
+        const uint32_t *users;
+        const uint8_t *values;
+        size_t len = store_item_profile(store, i, &users, &values);
+        knn_raters_t *r = &model->raters[i];
+
+        if (len == 0) {
+            continue;
+        }
+        r->users = malloc(len * sizeof(uint32_t));
+        if (r->users == NULL) {
+            knn_model_free(model);
+            return NULL;
+        }
+        memcpy(r->users, users, len * sizeof(uint32_t));
+        r->len = r->cap = len;
+    }
+
+    return model;
+}
+
+void knn_model_free(knn_model_t *model)
+{
+    if (model == NULL) {
+        return;
+    }
+    if (model->profiles) {
+        for (size_t u = 0; u < model->num_users; u++) {
+            free(model->profiles[u].items);
+            free(model->profiles[u].ratings);
+        }
+    }
+    if (model->raters) {
+        for (size_t i = 0; i < model->num_items; i++) {
+            free(model->raters[i].users);
+        }
+    }
+    free(model->profiles);
+    free(model->raters);
+    free(model->item_sum);
+    free(model->item_count);
+    free(model->item_mean);
+    free(model);
+}
+
+static int grow_users(knn_model_t *model, size_t num_users)
+{
+    if (num_users > model->cap_users) {
+        size_t cap = model->cap_users * 2;
+        while (cap < num_users) {
+            cap *= 2;
+        }
+        knn_profile_t *profiles = realloc(model->profiles, cap * sizeof(knn_profile_t));
+        if (profiles == NULL) {
+            return -1;
+        }
+        memset(profiles + model->cap_users, 0, (cap - model->cap_users) * sizeof(knn_profile_t));
+        model->profiles = profiles;
+        model->cap_users = cap;
+    }
+    if (num_users > model->num_users) {
+        model->num_users = num_users;
+    }
+    return 0;
+}
+
+static int grow_items(knn_model_t *model, size_t num_items)
+{
+    if (num_items > model->cap_items) {
+        size_t cap = model->cap_items * 2;
+        while (cap < num_items) {
+            cap *= 2;
+        }
+        double *item_sum = realloc(model->item_sum, cap * sizeof(double));
+        if (item_sum == NULL) {
+            return -1;
+        }
+        model->item_sum = item_sum;
+        uint32_t *item_count = realloc(model->item_count, cap * sizeof(uint32_t));
+        if (item_count == NULL) {
+            return -1;
+        }
+        model->item_count = item_count;
+        float *item_mean = realloc(model->item_mean, cap * sizeof(float));
+        if (item_mean == NULL) {
+            return -1;
+        }
+        model->item_mean = item_mean;
+        knn_raters_t *raters = realloc(model->raters, cap * sizeof(knn_raters_t));
+        if (raters == NULL) {
+            return -1;
+        }
+        model->raters = raters;
+        memset(raters + model->cap_items, 0, (cap - model->cap_items) * sizeof(knn_raters_t));
+        memset(item_sum + model->cap_items, 0, (cap - model->cap_items) * sizeof(double));
+        memset(item_count + model->cap_items, 0, (cap - model->cap_items) * sizeof(uint32_t));
+        memset(item_mean + model->cap_items, 0, (cap - model->cap_items) * sizeof(float));
+        model->cap_items = cap;
+    }
+    if (num_items > model->num_items) {
+        model->num_items = num_items;
+    }
+    return 0;
+}
+
+// Position de item dans le profil, ou position d'insertion
+static size_t profile_search(const knn_profile_t *p, uint32_t item)
+{
+    size_t lo = 0, hi = p->len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (p->items[mid] < item) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+int knn_model_add_rating(knn_model_t *model, uint32_t user, uint32_t item, double rating)
+{
+    if (grow_users(model, (size_t)user + 1) != 0 || grow_items(model, (size_t)item + 1) != 0) {
+        return -1;
+    }
+
+    knn_profile_t *p = &model->profiles[user];
+    size_t pos = profile_search(p, item);
+
+    // Note déjà présente : on la remplace
+    if (pos < p->len && p->items[pos] == item) {
+        p->sum += (float)rating - p->ratings[pos];
+        p->sum_sq += (float)rating * (float)rating - p->ratings[pos] * p->ratings[pos];
+        model->item_sum[item] += (float)rating - p->ratings[pos];
+        p->ratings[pos] = (float)rating;
+        model->item_mean[item] = model->item_sum[item] / model->item_count[item];
+        return 0;
+    }
+
+    knn_raters_t *r = &model->raters[item];
+    if (r->len == r->cap) {
+        size_t cap = r->cap ? r->cap * 2 : 8;
+        uint32_t *users = realloc(r->users, cap * sizeof(uint32_t));
+        if (users == NULL) {
+            return -1;
+        }
+        r->users = users;
+        r->cap = cap;
+    }
+
+    if (p->len == p->cap) {
+        size_t cap = p->cap ? p->cap * 2 : 8;
+        uint32_t *items = realloc(p->items, cap * sizeof(uint32_t));
+        if (items == NULL) {
+            return -1;
+        }
+        p->items = items;
+        float *ratings = realloc(p->ratings, cap * sizeof(float));
+        if (ratings == NULL) {
+            return -1;
+        }
+        p->ratings = ratings;
+        p->cap = cap;
+    }
+
+    memmove(p->items + pos + 1, p->items + pos, (p->len - pos) * sizeof(uint32_t));
+    memmove(p->ratings + pos + 1, p->ratings + pos, (p->len - pos) * sizeof(float));
+    p->items[pos] = item;
+    p->ratings[pos] = (float)rating;
+    p->len++;
+    r->users[r->len++] = user;
+    p->sum += (float)rating;
+    p->sum_sq += (float)rating * (float)rating;
+    model->item_sum[item] += (float)rating;
+    model->item_count[item]++;
+    model->item_mean[item] = model->item_sum[item] / model->item_count[item];
+    return 0;
+}
+
+double knn_model_rating(const knn_model_t *model, uint32_t user, uint32_t item)
+{
+    if (user >= model->num_users) {
+        return -1.0;
+    }
+    const knn_profile_t *p = &model->profiles[user];
+    size_t pos = profile_search(p, item);
+    return (pos < p->len && p->items[pos] == item) ? p->ratings[pos] : -1.0;
+}
+
+double knn_model_similarity(const knn_model_t *model, uint32_t user1, uint32_t user2)
+{
+    const knn_profile_t *a = &model->profiles[user1];
+    const knn_profile_t *b = &model->profiles[user2];
+    sparse_vector_t va = { a->items, a->ratings, a->len };
+    sparse_vector_t vb = { b->items, b->ratings, b->len };
+    return sparse_similarity(model->similarity, va, vb, model->item_mean);
+}
+
+// Distance cosinus entre profils centrés sur la moyenne de chaque user
+// (items non notés = 0) : 1 - <x - mx, y - my> / (|x - mx| |y - my|)
+float knn_model_distance(const void *space, uint32_t user1, uint32_t user2)
+{
+    const knn_model_t *model = space;
+    const knn_profile_t *a = &model->profiles[user1];
+    const knn_profile_t *b = &model->profiles[user2];
+    if (a->len == 0 || b->len == 0) {
+        return 1.0f;
+    }
+
+    sparse_vector_t va = { a->items, a->ratings, a->len };
+    sparse_vector_t vb = { b->items, b->ratings, b->len };
+    similarity_stats_t s;
+    sparse_similarity_stats(va, vb, NULL, &s);
+
+    double mean_a = a->sum / a->len;
+    double mean_b = b->sum / b->len;
+    double dot = s.sum_xy - mean_b * s.sum_x - mean_a * s.sum_y + s.count * mean_a * mean_b;
+    double norm_a = a->sum_sq - a->len * mean_a * mean_a;
+    double norm_b = b->sum_sq - b->len * mean_b * mean_b;
+    if (norm_a < 1e-9 || norm_b < 1e-9) {
+        return 1.0f;
+    }
+    return (float)(1.0 - dot / sqrt(norm_a * norm_b));
+}
+
+// Repli sans voisin utile : moyenne de l'item, puis moyenne du user
+static double fallback_prediction(const knn_model_t *model, uint32_t user, uint32_t item)
+{
+    if (model->item_count[item] > 0) {
+        return model->item_sum[item] / model->item_count[item];
+    }
+    const knn_profile_t *p = &model->profiles[user];
+    return p->len > 0 ? p->sum / p->len : 2.5;
+}
+
+// Balayage d'une tranche de users vers le tas partiel du worker
+typedef struct {
+    const knn_model_t *model;
+    uint32_t user;
+    topn_t *tops;            // un tas par worker
+} neighborhood_scan_t;
+
+static void scan_users(void *arg, size_t begin, size_t end, size_t worker)
+{
+    neighborhood_scan_t *scan = arg;
+    topn_t *top = &scan->tops[worker];
+    for (size_t v = begin; v < end; v++) {
+        if (v != scan->user) {
+            topn_push(top, (uint32_t)v, knn_model_similarity(scan->model, scan->user, (uint32_t)v));
+        }
+    }
+}
+
+int knn_model_neighborhood(const knn_model_t *model, uint32_t user, size_t k, knn_neighborhood_t *nb)
+{
+    memset(nb, 0, sizeof(*nb));
+    nb->user = user;
+    if (model == NULL || user >= model->num_users) {
+        return -1;
+    }
+
+    size_t n_users = model->num_users;
+    if (k > n_users - 1) {
+        k = n_users - 1;
+    }
+    if (k == 0) {
+        return 0;
+    }
+
+    // Un tas de k par worker : les workers ne partagent rien pendant le
+    // balayage, le tas final ne voit que workers x k candidats
+    size_t workers = pool_size(model->pool);
+    topn_t top = {0};
+    topn_t *tops = calloc(workers, sizeof(topn_t));
+    int failed = tops == NULL || topn_init(&top, k) != 0;
+    for (size_t w = 0; w < workers && !failed; w++) {
+        failed = topn_init(&tops[w], k) != 0;
+    }
+    if (!failed) {
+        neighborhood_scan_t scan = { model, user, tops };
+        pool_parallel_for(model->pool, n_users, KNN_SCAN_GRAIN, scan_users, &scan);
+        for (size_t w = 0; w < workers; w++) {
+            for (size_t i = 0; i < tops[w].len; i++) {
+                topn_push(&top, tops[w].heap[i].id, tops[w].heap[i].score);
+            }
+        }
+        nb->users = malloc(k * sizeof(uint32_t));
+        nb->similarity = malloc(k * sizeof(double));
+        failed = nb->users == NULL || nb->similarity == NULL;
+    }
+    for (size_t w = 0; tops != NULL && w < workers; w++) {
+        topn_free(&tops[w]);
+    }
+    free(tops);
+    if (failed) {
+        knn_neighborhood_free(nb);
+        topn_free(&top);
+        return -1;
+    }
+
+    nb->len = topn_finish(&top);
+    for (size_t i = 0; i < nb->len; i++) {
+        nb->users[i] = top.heap[i].id;
+        nb->similarity[i] = top.heap[i].score;
+    }
+    topn_free(&top);
+    return 0;
+}
+
+void knn_neighborhood_free(knn_neighborhood_t *nb)
+{
+    if (nb == NULL) {
+        return;
+    }
+    free(nb->users);
+    free(nb->similarity);
+    nb->users = NULL;
+    nb->similarity = NULL;
+    nb->len = 0;
+}
+
+double knn_neighborhood_predict(const knn_model_t *model, const knn_neighborhood_t *nb, uint32_t item)
+{
+    if (model == NULL || nb->user >= model->num_users || item >= model->num_items) {
+        return 0.0;
+    }
+
+    double weighted_sum = 0.0;
+    double correlation_sum = 0.0;
+    for (size_t i = 0; i < nb->len; i++) {
+        double rating = knn_model_rating(model, nb->users[i], item);
+        double abs_correlation = fabs(nb->similarity[i]);
+        if (rating >= 0.0 && abs_correlation > 0.001) {
+            weighted_sum += abs_correlation * rating;
+            correlation_sum += abs_correlation;
+        }
+    }
+
+    if (correlation_sum >= 0.001) {
+        return weighted_sum / correlation_sum;
+    }
+    return fallback_prediction(model, nb->user, item);
+}
+
+int knn_neighborhood_rank(const knn_model_t *model, const knn_neighborhood_t *nb, topn_t *top)
+{
+    if (model == NULL || nb->user >= model->num_users) {
+        return -1;
+    }
+
+    size_t n_items = model->num_items;
+    double *weighted_sum = calloc(n_items ? n_items : 1, sizeof(double));
+    double *correlation_sum = calloc(n_items ? n_items : 1, sizeof(double));
+    if (weighted_sum == NULL || correlation_sum == NULL) {
+        free(weighted_sum);
+        free(correlation_sum);
+        return -1;
+    }
+
+    // Un passage par voisin sur son profil, au lieu d'une recherche par (voisin, item)
+    for (size_t i = 0; i < nb->len; i++) {
+        double abs_correlation = fabs(nb->similarity[i]);
+        if (abs_correlation <= 0.001) {
+            continue;
+        }
+        const knn_profile_t *p = &model->profiles[nb->users[i]];
+        for (size_t e = 0; e < p->len; e++) {
+            weighted_sum[p->items[e]] += abs_correlation * p->ratings[e];
+            correlation_sum[p->items[e]] += abs_correlation;
+        }
+    }
+
+    // Parcours du catalogue en sautant les items du profil (trié) du user
+    const knn_profile_t *own = &model->profiles[nb->user];
+    size_t next = 0;
+    for (uint32_t item = 0; item < n_items; item++) {
+        if (next < own->len && own->items[next] == item) {
+            next++;
+            continue;
+        }
+        double score = correlation_sum[item] >= 0.001
+                     ? weighted_sum[item] / correlation_sum[item]
+                     : fallback_prediction(model, nb->user, item);
+        topn_push(top, item, score);
+    }
+
+    free(weighted_sum);
+    free(correlation_sum);
+    return 0;
+}
+
+double knn_model_predict(const knn_model_t *model, size_t k, uint32_t user, uint32_t item)
+{
+    knn_neighborhood_t nb;
+    if (knn_model_neighborhood(model, user, k, &nb) != 0) {
+        return 0.0;
+    }
+    double prediction = knn_neighborhood_predict(model, &nb, item);
+    knn_neighborhood_free(&nb);
+    return prediction;
+}
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "knn.h"
+
+// Au-delà de ce rapport de longueurs, on parcourt la liste courte et on
+// cherche chacun de ses items dans la longue par recherche exponentielle
+#define GALLOP_RATIO 16
+
+// Première position >= key dans index[lo, len), en partant de lo
+static size_t gallop(const uint32_t *index, size_t lo, size_t len, uint32_t key)
+{
+    size_t hi = lo;
+    size_t step = 1;
+
+    while (hi < len && index[hi] < key) {
+        lo = hi + 1;
+        hi += step;
+        step <<= 1;
+    }
+    if (hi > len) {
+        hi = len;
+    }
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void accumulate(similarity_stats_t *s, double x, double y)
+{
+    s->sum_x += x;
+    s->sum_y += y;
+    s->sum_xx += x * x;
+    s->sum_yy += y * y;
+    s->sum_xy += x * y;
+    s->count++;
+}
+
+void sparse_similarity_stats(sparse_vector_t a, sparse_vector_t b, const float *center, similarity_stats_t *s)
+{
+    s->count = 0;
+    s->sum_x = s->sum_y = s->sum_xx = s->sum_yy = s->sum_xy = 0.0;
+
+    int swapped = 0;
+    if (a.len > b.len) {
+        sparse_vector_t t = a;
+        a = b;
+        b = t;
+        swapped = 1;
+    }
+    if (a.len == 0) {
+        return;
+    }
+
+    size_t i = 0, j = 0;
+    if (b.len / a.len >= GALLOP_RATIO) {
+        // Intersection galopante : O(len_a x log(len_b / len_a))
+        for (; i < a.len && j < b.len; i++) {
+            j = gallop(b.index, j, b.len, a.index[i]);
+            if (j < b.len && b.index[j] == a.index[i]) {
+                double c = center ? center[a.index[i]] : 0.0;
+                double x = a.value[i] - c;
+                double y = b.value[j] - c;
+                accumulate(s, swapped ? y : x, swapped ? x : y);
+                j++;
+            }
+        }
+    } else {
+        // Fusion des deux listes triées : O(len_a + len_b)
+        while (i < a.len && j < b.len) {
+            if (a.index[i] < b.index[j]) {
+                i++;
+            } else if (a.index[i] > b.index[j]) {
+                j++;
+            } else {
+                double c = center ? center[a.index[i]] : 0.0;
+                double x = a.value[i++] - c;
+                double y = b.value[j++] - c;
+                accumulate(s, swapped ? y : x, swapped ? x : y);
+            }
+        }
+    }
+}
+
+static double clamp_correlation(double correlation)
+{
+    if (correlation > 1.0) correlation = 1.0;
+    if (correlation < -1.0) correlation = -1.0;
+    return correlation;
+}
+
+// Mêmes conventions que pearson_correlation_centered()
+double similarity_pearson(const similarity_stats_t *s)
+{
+    if (s->count < 1) {
+        return 0.0;
+    }
+    if (s->count == 1) {
+        return 0.2;
+    }
+
+    double n = (double)s->count;
+    double numerator = s->sum_xy - s->sum_x * s->sum_y / n;
+    double denom_x = s->sum_xx - s->sum_x * s->sum_x / n;
+    double denom_y = s->sum_yy - s->sum_y * s->sum_y / n;
+    double denominator = sqrt(fmax(denom_x, 0.0) * fmax(denom_y, 0.0));
+    if (denominator < 0.001) {
+        return 0.2;
+    }
+    return clamp_correlation(numerator / denominator);
+}
+
+// Cosinus sur les items communs (valeurs déjà centrées pour le cosinus ajusté)
+double similarity_cosine(const similarity_stats_t *s)
+{
+    double denominator = sqrt(s->sum_xx * s->sum_yy);
+    if (s->count < 1 || denominator < 1e-12) {
+        return 0.0;
+    }
+    return clamp_correlation(s->sum_xy / denominator);
+}
+
+double sparse_pearson_centered(sparse_vector_t a, sparse_vector_t b)
+{
+    similarity_stats_t s;
+    sparse_similarity_stats(a, b, NULL, &s);
+    return similarity_pearson(&s);
+}
+
+double sparse_cosine(sparse_vector_t a, sparse_vector_t b)
+{
+    similarity_stats_t s;
+    sparse_similarity_stats(a, b, NULL, &s);
+    return similarity_cosine(&s);
+}
+
+double sparse_adjusted_cosine(sparse_vector_t a, sparse_vector_t b, const float *center)
+{
+    similarity_stats_t s;
+    sparse_similarity_stats(a, b, center, &s);
+    return similarity_cosine(&s);
+}
+
+double sparse_similarity(similarity_kind_t kind, sparse_vector_t a, sparse_vector_t b, const float *center)
+{
+    switch (kind) {
+        case SIM_COSINE:
+            return sparse_cosine(a, b);
+        case SIM_ADJUSTED_COSINE:
+            return sparse_adjusted_cosine(a, b, center);
+        case SIM_PEARSON:
+        default:
+            return sparse_pearson_centered(a, b);
+    }
+}
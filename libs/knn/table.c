@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knn.h"
+
+// En-tête du fichier de table (suivi de neighbors puis scores)
+typedef struct KNNTableHeader {
+    char magic[8];
+    uint64_t num_users;
+    uint64_t k;
+    uint64_t fingerprint;
+} knn_table_header_t;
+
+static int table_reserve(knn_table_t *table, size_t num_users)
+{
+    if (num_users <= table->cap_users) {
+        return 0;
+    }
+
+    size_t cap = table->cap_users ? table->cap_users : 16;
+    while (cap < num_users) {
+        cap *= 2;
+    }
+    uint32_t *neighbors = realloc(table->neighbors, cap * table->k * sizeof(uint32_t));
+    if (neighbors == NULL) {
+        return -1;
+    }
+    table->neighbors = neighbors;
+    float *scores = realloc(table->scores, cap * table->k * sizeof(float));
+    if (scores == NULL) {
+        return -1;
+    }
+    table->scores = scores;
+    uint8_t *stale = realloc(table->stale, cap);
+    if (stale == NULL) {
+        return -1;
+    }
+    table->stale = stale;
+    table->cap_users = cap;
+    return 0;
+}
+
+// Ajoute des lignes vides à calculer jusqu'à num_users
+static int table_grow(knn_table_t *table, size_t num_users)
+{
+    if (num_users <= table->num_users) {
+        return 0;
+    }
+    if (table_reserve(table, num_users) != 0) {
+        return -1;
+    }
+    size_t k = table->k;
+    for (size_t e = table->num_users * k; e < num_users * k; e++) {
+        table->neighbors[e] = KNN_TABLE_NONE;
+        table->scores[e] = 0.0f;
+    }
+    memset(table->stale + table->num_users, 1, num_users - table->num_users);
+    table->num_users = num_users;
+    return 0;
+}
+
+int knn_table_init(knn_table_t *table, size_t num_users, size_t k)
+{
+    memset(table, 0, sizeof(*table));
+    table->k = k ? k : 1;
+    if (table_grow(table, num_users) != 0) {
+        knn_table_free(table);
+        return -1;
+    }
+    return 0;
+}
+
+void knn_table_free(knn_table_t *table)
+{
+    if (table == NULL) {
+        return;
+    }
+    free(table->neighbors);
+    free(table->scores);
+    free(table->stale);
+    memset(table, 0, sizeof(*table));
+}
+
+int knn_table_refresh_row(knn_table_t *table, const knn_model_t *model, uint32_t user)
+{
+    if (table_grow(table, model->num_users) != 0 || user >= table->num_users) {
+        return -1;
+    }
+
+    knn_neighborhood_t nb;
+    if (knn_model_neighborhood(model, user, table->k, &nb) != 0) {
+        return -1;
+    }
+
+    uint32_t *ids = table->neighbors + (size_t)user * table->k;
+    float *scores = table->scores + (size_t)user * table->k;
+    for (size_t j = 0; j < table->k; j++) {
+        ids[j] = j < nb.len ? nb.users[j] : KNN_TABLE_NONE;
+        scores[j] = j < nb.len ? (float)nb.similarity[j] : 0.0f;
+    }
+    table->stale[user] = 0;
+
+    knn_neighborhood_free(&nb);
+    return 0;
+}
+
+// Lignes en attente d'une tranche de users (les lignes sont disjointes)
+typedef struct {
+    knn_table_t *table;
+    const knn_model_t *model;
+    int failed;
+} table_build_t;
+
+static void build_rows(void *arg, size_t begin, size_t end, size_t worker)
+{
+    table_build_t *build = arg;
+    (void)worker;
+    for (size_t u = begin; u < end; u++) {
+        if (build->table->stale[u] && knn_table_refresh_row(build->table, build->model, (uint32_t)u) != 0) {
+            __atomic_store_n(&build->failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+int knn_table_build(knn_table_t *table, const knn_model_t *model)
+{
+    if (table_grow(table, model->num_users) != 0) {
+        return -1;
+    }
+    // Chaque ligne balaie tous les users : quelques lignes par tâche
+    // suffisent à équilibrer la charge (le balayage interne reste séquentiel)
+    table_build_t build = { table, model, 0 };
+    pool_parallel_for(model->pool, table->num_users, 8, build_rows, &build);
+    return build.failed ? -1 : 0;
+}
+
+// Place (user, score) dans la ligne de row en gardant l'ordre décroissant.
+// Retourne -1 si la ligne ne peut pas être corrigée en place et doit être recalculée.
+static int row_update(knn_table_t *table, uint32_t row, uint32_t user, float score)
+{
+    size_t k = table->k;
+    uint32_t *ids = table->neighbors + (size_t)row * k;
+    float *scores = table->scores + (size_t)row * k;
+
+    // Retirer user de la ligne s'il y figure
+    size_t len = 0;
+    int present = 0;
+    for (size_t j = 0; j < k && ids[j] != KNN_TABLE_NONE; j++) {
+        if (ids[j] == user) {
+            present = 1;
+            continue;
+        }
+        ids[len] = ids[j];
+        scores[len] = scores[j];
+        len++;
+    }
+    for (size_t j = len; j < k; j++) {
+        ids[j] = KNN_TABLE_NONE;
+        scores[j] = 0.0f;
+    }
+
+    // Ligne pleine sans user, et user n'y entre pas
+    if (len == k && (score < scores[k - 1] || (score == scores[k - 1] && user > ids[k - 1]))) {
+        return 0;
+    }
+    // user occupait l'une des k places : s'il recule derrière le dernier
+    // voisin connu, la dernière place revient peut-être à un user absent
+    if (present && len == k - 1 &&
+        (len == 0 || score < scores[len - 1] || (score == scores[len - 1] && user > ids[len - 1]))) {
+        return -1;
+    }
+
+    size_t pos = len < k ? len : k - 1;
+    while (pos > 0 && (scores[pos - 1] < score || (scores[pos - 1] == score && ids[pos - 1] > user))) {
+        ids[pos] = ids[pos - 1];
+        scores[pos] = scores[pos - 1];
+        pos--;
+    }
+    ids[pos] = user;
+    scores[pos] = score;
+    return 0;
+}
+
+int knn_table_update(knn_table_t *table, const knn_model_t *model, uint32_t user, uint32_t item)
+{
+    if (table_grow(table, model->num_users) != 0 || user >= table->num_users || item >= model->num_items) {
+        return -1;
+    }
+    table->stale[user] = 1;
+
+    // Seules les similarités avec les users ayant aussi noté item changent
+    const knn_raters_t *raters = &model->raters[item];
+    for (size_t e = 0; e < raters->len; e++) {
+        uint32_t v = raters->users[e];
+        if (v == user || v >= table->num_users || table->stale[v]) {
+            continue;
+        }
+        float score = (float)knn_model_similarity(model, v, user);
+        if (row_update(table, v, user, score) != 0) {
+            table->stale[v] = 1;
+        }
+    }
+    return 0;
+}
+
+int knn_table_neighborhood(knn_table_t *table, const knn_model_t *model, uint32_t user,
+                           size_t k, knn_neighborhood_t *nb)
+{
+    memset(nb, 0, sizeof(*nb));
+    nb->user = user;
+    if (table_grow(table, model->num_users) != 0 || user >= table->num_users) {
+        return -1;
+    }
+    if (table->stale[user] && knn_table_refresh_row(table, model, user) != 0) {
+        return -1;
+    }
+
+    if (k > table->k) {
+        k = table->k;
+    }
+    const uint32_t *ids = table->neighbors + (size_t)user * table->k;
+    const float *scores = table->scores + (size_t)user * table->k;
+    size_t len = 0;
+    while (len < k && ids[len] != KNN_TABLE_NONE) {
+        len++;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    nb->users = malloc(len * sizeof(uint32_t));
+    nb->similarity = malloc(len * sizeof(double));
+    if (nb->users == NULL || nb->similarity == NULL) {
+        knn_neighborhood_free(nb);
+        return -1;
+    }
+    for (size_t j = 0; j < len; j++) {
+        nb->users[j] = ids[j];
+        nb->similarity[j] = scores[j];
+    }
+    nb->len = len;
+    return 0;
+}
+
+int knn_table_save(const knn_table_t *table, const char *path)
+{
+    for (size_t u = 0; u < table->num_users; u++) {
+        if (table->stale[u]) {
+            fprintf(stderr, "Error: KNN table has rows left to compute\n");
+            return -1;
+        }
+    }
+
+    knn_table_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, KNN_TABLE_MAGIC, sizeof(KNN_TABLE_MAGIC));
+    header.num_users = table->num_users;
+    header.k = table->k;
+    header.fingerprint = table->fingerprint;
+
+    // Écriture dans un fichier temporaire puis renommage : un serveur qui
+    // démarre ne voit jamais de table à moitié écrite
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        return -1;
+    }
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        perror("Failed to create KNN table");
+        return -1;
+    }
+    size_t cells = table->num_users * table->k;
+    int rc = 0;
+    if (fwrite(&header, sizeof(header), 1, f) != 1 ||
+        fwrite(table->neighbors, sizeof(uint32_t), cells, f) != cells ||
+        fwrite(table->scores, sizeof(float), cells, f) != cells) {
+        rc = -1;
+    }
+    if (fclose(f) != 0) {
+        rc = -1;
+    }
+    if (rc != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Error: Failed to write KNN table %s\n", path);
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+int knn_table_load(knn_table_t *table, const char *path)
+{
+    memset(table, 0, sizeof(*table));
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+
+    knn_table_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.magic, KNN_TABLE_MAGIC, sizeof(KNN_TABLE_MAGIC)) != 0 ||
+        header.k == 0 || header.k > UINT32_MAX) {
+        fprintf(stderr, "Error: %s is not a KNN table\n", path);
+        fclose(f);
+        return -1;
+    }
+    // Les voisins sont des index uint32 ; num_users x k cases doivent tenir en mémoire
+    if (header.num_users > UINT32_MAX || header.num_users > SIZE_MAX / sizeof(uint32_t) / header.k) {
+        fprintf(stderr, "Error: KNN table %s is corrupted\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    if (knn_table_init(table, header.num_users, header.k) != 0) {
+        fclose(f);
+        return -1;
+    }
+    size_t cells = header.num_users * header.k;
+    if (fread(table->neighbors, sizeof(uint32_t), cells, f) != cells ||
+        fread(table->scores, sizeof(float), cells, f) != cells) {
+        fprintf(stderr, "Error: KNN table %s is truncated\n", path);
+        knn_table_free(table);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    // Les voisins servent d'index dans les profils du modèle
+    for (size_t e = 0; e < cells; e++) {
+        if (table->neighbors[e] != KNN_TABLE_NONE && table->neighbors[e] >= header.num_users) {
+            fprintf(stderr, "Error: KNN table %s is corrupted\n", path);
+            knn_table_free(table);
+            return -1;
+        }
+    }
+    memset(table->stale, 0, table->num_users);
+    table->fingerprint = header.fingerprint;
+    return 0;
+}
@@ -83,33 +83,38 @@ int main() {
     printf("Paramètres: k=%zu, alpha=%.3f, lambda=%.3f, epochs=%zu\n", 
            k, alpha, lambda, epochs);
 
-    // Étape 1 : Construire la matrice de notes pleines avec MF
-    printf("\n--- Construction de la matrice de notes pleines ---\n");
-    ndarray_t full_matrix = MF(train_data, 0, k,  alpha, lambda, epochs);
-    if (full_matrix.shape[0] == 0) {
-        printf("Erreur: échec de la construction de la matrice pleine\n");
+    // Étape 1 : Entraîner le modèle MF
+    printf("\n--- Entraînement du modèle ---\n");
+    id_map_t users = {0}, items = {0};
+    mf_model_t *model = MF(train_data, 0, k,  alpha, lambda, epochs, &users, &items);
+    if (model == NULL) {
+        printf("Erreur: échec de l'entraînement du modèle\n");
+        id_map_free(&users);
+        id_map_free(&items);
         return 1;
     }
-    printf("Matrice pleine créée (shape: %zu x %zu)\n", full_matrix.shape[0], full_matrix.shape[1]);
+    printf("Modèle entraîné (%zu utilisateurs x %zu items)\n", model->num_users, model->num_items);
     
-    // Afficher un échantillon de la matrice (limité pour éviter trop de sortie)
-    printf("\nÉchantillon de la matrice pleine (5 premières lignes/colonnes) :\n");
-    size_t sample_rows = (full_matrix.shape[0] < 5) ? full_matrix.shape[0] : 5;
-    size_t sample_cols = (full_matrix.shape[1] < 5) ? full_matrix.shape[1] : 5;
+    // Afficher un échantillon des scores (5 premiers utilisateurs/items)
+    printf("\nÉchantillon des scores (5 premiers utilisateurs/items) :\n");
+    size_t sample_rows = (model->num_users < 5) ? model->num_users : 5;
+    size_t sample_cols = (model->num_items < 5) ? model->num_items : 5;
+    float sample[5];
     
     for (size_t i = 0; i < sample_rows; i++) {
+        mf_score_user(model, i, NULL, sample_cols, sample);
         for (size_t j = 0; j < sample_cols; j++) {
-            printf("%6.2f ", full_matrix.data[i][j]);
+            printf("%6.2f ", sample[j]);
         }
         printf("\n");
     }
 
     // Étape 2 : Prédire les notes pour les données de test
     printf("\n--- Prédiction des notes pour les données de test ---\n");
-    ndarray_t predictions = Predict_all_MF(full_matrix, 0, test_data);
+    ndarray_t predictions = Predict_all_MF(model, 0, test_data, &users, &items);
     if (predictions.shape[0] == 0) {
         printf("Erreur: échec de la prédiction\n");
-        clean(&full_matrix, NULL);
+        mf_model_free(model);
         return 1;
     }
 
@@ -117,7 +122,8 @@ int main() {
     ndarray_t test_array = load_ndarray(test_data, 0);
     if (!test_array.data) {
         printf("Erreur: échec du chargement des données de test pour l'évaluation\n");
-        clean(&full_matrix, &predictions, NULL);
+        clean(&predictions, NULL);
+        mf_model_free(model);
         return 1;
     }
 
@@ -147,17 +153,20 @@ int main() {
     // Statistiques supplémentaires
     printf("\n--- Statistiques supplémentaires ---\n");
     printf("Taille de la matrice complète : %zu utilisateurs x %zu items\n", 
-           full_matrix.shape[0], full_matrix.shape[1]);
+           model->num_users, model->num_items);
     printf("Nombre total de prédictions : %zu\n", predictions.shape[0]);
     
     // Calculer la sparsité du jeu de test
     double sparsity = (double)(predictions.shape[0]) / 
-                     (double)(full_matrix.shape[0] * full_matrix.shape[1]) * 100.0;
+                     (double)(model->num_users * model->num_items) * 100.0;
     printf("Sparsité du jeu de test : %.2f%%\n", sparsity);
 
     // Nettoyage
     free_array(&test_array);
-    clean(&full_matrix, &predictions, NULL);
+    clean(&predictions, NULL);
+    mf_model_free(model);
+    id_map_free(&users);
+    id_map_free(&items);
 
     printf("\n=== Fin de l'évaluation ===\n");
     return 0;
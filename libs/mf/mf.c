@@ -2,16 +2,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <ndmath/array.h>
 #include <ndmath/helper.h>
 #include <ndmath/operations.h>
 #include <ndmath/io.h>
 #include <math.h>
+#include <core/kernels.h>
+#include <core/store.h>
 
 #include "mf.h"
 
 // Fonction pour convertir ndarray en tableau de transactions
-Transaction* ndarray_to_transactions(ndarray_t data, size_t* num_transactions) {
+Transaction* ndarray_to_transactions(ndarray_t data, size_t* num_transactions,
+                                     id_map_t *users, id_map_t *items) {
     if (!data.data || data.shape[0] == 0 || data.shape[1] < 3) {
         printf("Erreur: données invalides (shape: %zu x %zu)\n", data.shape[0], data.shape[1]);
         *num_transactions = 0;
@@ -28,9 +36,17 @@ Transaction* ndarray_to_transactions(ndarray_t data, size_t* num_transactions) {
 
     for (size_t i = 0; i < count; i++) {
         // Colonnes: user_id, item_id, category_id, rating, timestamp
-        // On ajuste pour index 0 (les données sont en index 1)
-        transactions[i].user_id = (size_t)data.data[i][0] - 1;
-        transactions[i].item_id = (size_t)data.data[i][1] - 1;
+        // Les identifiants externes sont convertis en index denses
+        uint32_t user = id_map_intern(users, (uint64_t)data.data[i][0]);
+        uint32_t item = id_map_intern(items, (uint64_t)data.data[i][1]);
+        if (user == ID_MAP_NONE || item == ID_MAP_NONE) {
+            printf("Erreur: échec de l'ajout des identifiants de la ligne %zu\n", i);
+            free(transactions);
+            *num_transactions = 0;
+            return NULL;
+        }
+        transactions[i].user_id = user;
+        transactions[i].item_id = item;
         transactions[i].rating = data.data[i][3]; // La note est en colonne 3
         transactions[i].timestamp = data.data[i][4]; // Timestamp est la colone 4
     }
@@ -40,162 +56,1078 @@ Transaction* ndarray_to_transactions(ndarray_t data, size_t* num_transactions) {
     return transactions;
 }
 
-ndarray_t MF(const char* train_data, size_t batch_size, size_t k, double alpha, double lambda, size_t epochs) {
+// Numéro de version du prochain modèle entraîné (croissant dans le processus)
+static uint64_t next_version = 0;
+
+// Libère des lignes compactées, sauf si elles sont dans la projection du fichier
+static void free_rows(const mf_model_t *model, float *rows) {
+    const char *p = (const char *)rows;
+    const char *base = model->mapping;
+    if (base == NULL || p < base || p >= base + model->mapping_length) {
+        free(rows);
+    }
+}
+
+void mf_model_free(mf_model_t *model) {
+    if (model == NULL) {
+        return;
+    }
+    if (model->U.data != NULL) {
+        clean(&model->U, &model->V, &model->O, &model->P, NULL);
+    }
+    free_rows(model, model->user_factors);
+    free_rows(model, model->item_factors);
+    free_rows(model, model->user_bias);
+    free_rows(model, model->item_bias);
+    mf_mips_free(model->mips);
+    if (model->mapping != NULL) {
+        munmap(model->mapping, model->mapping_length);
+    }
+    free(model);
+}
+
+mf_model_t* mf_model_retain(mf_model_t *model) {
+    if (model != NULL) {
+        __atomic_add_fetch(&model->refs, 1, __ATOMIC_RELAXED);
+    }
+    return model;
+}
+
+void mf_model_release(mf_model_t *model) {
+    if (model != NULL && __atomic_sub_fetch(&model->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        mf_model_free(model);
+    }
+}
+
+// Le lecteur s'annonce avant de lire le pointeur et se retire après avoir
+// pris sa référence : le publieur attend que readers retombe à 0 après
+// l'échange, donc tout lecteur qui a vu l'ancien modèle le tient déjà.
+mf_model_t* mf_slot_acquire(mf_slot_t *slot) {
+    __atomic_add_fetch(&slot->readers, 1, __ATOMIC_SEQ_CST);
+    mf_model_t *model = mf_model_retain(__atomic_load_n(&slot->model, __ATOMIC_SEQ_CST));
+    __atomic_sub_fetch(&slot->readers, 1, __ATOMIC_SEQ_CST);
+    return model;
+}
+
+void mf_slot_publish(mf_slot_t *slot, mf_model_t *model) {
+    mf_model_t *old = __atomic_exchange_n(&slot->model, model, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&slot->readers, __ATOMIC_SEQ_CST) != 0) {
+        sched_yield();
+    }
+    mf_model_release(old);
+}
+
+// Graine utilisée quand params->seed vaut 0
+static const uint64_t default_seed = 0x9E3779B97F4A7C15ULL;
+
+// Générateur d'un flux : xorshift64* initialisé par splitmix64 (graine, flux)
+static uint64_t rng_init(uint64_t seed, uint64_t stream) {
+    uint64_t z = (seed ? seed : default_seed) + (stream + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+static uint64_t rng_next(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static double rng_uniform(uint64_t *state) {
+    return (rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Modèle initialisé : U et V aléatoires dans [0, 0.1], biais à 0.
+// Tirages reproductibles à graine égale.
+static mf_model_t* model_alloc(size_t num_users, size_t num_items, size_t k, uint64_t seed) {
+    mf_model_t *model = calloc(1, sizeof(mf_model_t));
+    if (model == NULL) {
+        return NULL;
+    }
+    model->num_users = num_users;
+    model->num_items = num_items;
+    model->k = k;
+    model->refs = 1;
+    model->U = array(num_users, k); // Facteurs latents utilisateurs
+    model->V = array(num_items, k); // Facteurs latents items
+    model->O = array(num_users, 1); // Biais utilisateurs
+    model->P = array(num_items, 1); // Biais items
+    if (!model->U.data || !model->V.data || !model->O.data || !model->P.data) {
+        printf("Erreur: échec de l'allocation du modèle (%zu users, %zu items, k=%zu)\n",
+               num_users, num_items, k);
+        mf_model_free(model);
+        return NULL;
+    }
+
+    uint64_t rng = rng_init(seed, 0);
+    for (size_t i = 0; i < num_users; i++) {
+        for (size_t j = 0; j < k; j++) {
+            model->U.data[i][j] = rng_uniform(&rng) * 0.1;
+        }
+        model->O.data[i][0] = 0.0;
+    }
+    for (size_t i = 0; i < num_items; i++) {
+        for (size_t j = 0; j < k; j++) {
+            model->V.data[i][j] = rng_uniform(&rng) * 0.1;
+        }
+        model->P.data[i][0] = 0.0;
+    }
+    return model;
+}
+
+// Un pas de SGD sur la note r de (i, j) ; retourne l'erreur au carré.
+// u_old reçoit une copie de U[i] (V est mis à jour avec l'ancienne valeur).
+static double sgd_step(mf_model_t *model, const mf_params_t *params, size_t i, size_t j, double r_ij,
+                       double *u_old) {
+    size_t k = model->k;
+    double alpha = params->alpha, lambda = params->lambda;
+    double *u = model->U.data[i], *v = model->V.data[j];
+    double *o = &model->O.data[i][0], *p = &model->P.data[j][0];
+
+    // Calculer la prédiction et l'erreur
+    double e_ij = r_ij - (*o + *p + kernel_dot(u, v, k));
+
+    // Mettre à jour O et P
+    *o += alpha * (e_ij - lambda * *o);
+    *p += alpha * (e_ij - lambda * *p);
+
+    // Mettre à jour U et V : u = (1 - alpha.lambda) u + alpha.e v, puis de même pour v
+    memcpy(u_old, u, k * sizeof(double));
+    kernel_axpby(alpha * e_ij, v, 1.0 - alpha * lambda, u, k);
+    kernel_axpby(alpha * e_ij, u_old, 1.0 - alpha * lambda, v, k);
+    return e_ij * e_ij;
+}
+
+static int check_dimensions(size_t num_users, size_t num_items, const mf_params_t *params) {
+    if (num_users == 0 || num_items == 0 || params->k == 0) {
+        printf("Erreur: dimensions invalides (max_users=%zu, max_items=%zu, k=%zu)\n",
+               num_users, num_items, params->k);
+        return -1;
+    }
+    return 0;
+}
+
+static float *alloc_rows(size_t rows, size_t stride) {
+    // aligned_alloc veut une taille multiple de l'alignement
+    size_t align = MF_ROW_ALIGN * sizeof(float);
+    size_t size = ((rows ? rows : 1) * stride * sizeof(float) + align - 1) / align * align;
+    float *data = aligned_alloc(align, size);
+    if (data != NULL) {
+        memset(data, 0, size);
+    }
+    return data;
+}
+
+// Recopie U, V, O et P dans la disposition compacte du scoring
+static int model_pack(mf_model_t *model) {
+    size_t k = model->k;
+    model->stride = (k + MF_ROW_ALIGN - 1) / MF_ROW_ALIGN * MF_ROW_ALIGN;
+    model->user_factors = alloc_rows(model->num_users, model->stride);
+    model->item_factors = alloc_rows(model->num_items, model->stride);
+    model->user_bias = alloc_rows(model->num_users, 1);
+    model->item_bias = alloc_rows(model->num_items, 1);
+    if (!model->user_factors || !model->item_factors || !model->user_bias || !model->item_bias) {
+        printf("Erreur: échec de l'allocation des facteurs compactés\n");
+        return -1;
+    }
+    model->cap_users = model->num_users;
+
+    for (size_t i = 0; i < model->num_users; i++) {
+        for (size_t j = 0; j < k; j++) {
+            model->user_factors[i * model->stride + j] = (float)model->U.data[i][j];
+        }
+        model->user_bias[i] = (float)model->O.data[i][0];
+    }
+    for (size_t i = 0; i < model->num_items; i++) {
+        for (size_t j = 0; j < k; j++) {
+            model->item_factors[i * model->stride + j] = (float)model->V.data[i][j];
+        }
+        model->item_bias[i] = (float)model->P.data[i][0];
+    }
+    return 0;
+}
+
+// Agrandit les lignes users compactées (nouvelles lignes à zéro)
+static int grow_users(mf_model_t *model, size_t num_users) {
+    if (num_users > model->cap_users) {
+        size_t cap = model->cap_users ? model->cap_users * 2 : 16;
+        while (cap < num_users) {
+            cap *= 2;
+        }
+        // realloc ne garantit pas l'alignement : nouvelle allocation et copie
+        float *factors = alloc_rows(cap, model->stride);
+        float *bias = alloc_rows(cap, 1);
+        if (factors == NULL || bias == NULL) {
+            free(factors);
+            free(bias);
+            return -1;
+        }
+        memcpy(factors, model->user_factors, model->num_users * model->stride * sizeof(float));
+        memcpy(bias, model->user_bias, model->num_users * sizeof(float));
+        free_rows(model, model->user_factors);
+        free_rows(model, model->user_bias);
+        model->user_factors = factors;
+        model->user_bias = bias;
+        model->cap_users = cap;
+    }
+    if (num_users > model->num_users) {
+        model->num_users = num_users;
+    }
+    return 0;
+}
+
+static int finish_training(mf_model_t *model, size_t num_ratings, const mf_params_t *params) {
+    if (model_pack(model) != 0) {
+        return -1;
+    }
+    model->num_ratings = num_ratings;
+    model->params = *params;
+    model->params.pool = NULL;
+    model->version = __atomic_add_fetch(&next_version, 1, __ATOMIC_RELAXED);
+    printf("Modèle MF v%llu entraîné (%zu transactions)\n", (unsigned long long)model->version, num_ratings);
+    return 0;
+}
+
+// Mélange de Fisher-Yates de samples[0, n)
+static void shuffle_samples(mf_sample_t *samples, size_t n, uint64_t *rng) {
+    for (size_t i = n; i > 1; i--) {
+        size_t j = rng_next(rng) % i;
+        mf_sample_t t = samples[i - 1];
+        samples[i - 1] = samples[j];
+        samples[j] = t;
+    }
+}
+
+// Une époque Hogwild : les notes sont réparties en tranches contiguës, une
+// par thread. Chaque tranche est mélangée avec son propre générateur puis
+// parcourue en mettant à jour U, V, O et P partagés, sans verrou : deux
+// tranches ne touchent que rarement la même ligne en même temps et une
+// écriture perdue ne fait que retarder la convergence.
+typedef struct {
+    mf_model_t *model;
+    const mf_params_t *params;
+    mf_sample_t *samples;
+    size_t num_samples;
+    size_t num_slices;
+    uint64_t *rng;           // un générateur par tranche
+    double *u_old;           // k doubles par tranche
+    double *error;           // erreur au carré par tranche
+} hogwild_epoch_t;
+
+static void hogwild_slices(void *arg, size_t begin, size_t end, size_t worker) {
+    hogwild_epoch_t *epoch = arg;
+    (void)worker;
+    for (size_t b = begin; b < end; b++) {
+        size_t first = b * epoch->num_samples / epoch->num_slices;
+        size_t last = (b + 1) * epoch->num_samples / epoch->num_slices;
+        mf_sample_t *samples = epoch->samples + first;
+        double *u_old = epoch->u_old + b * epoch->model->k;
+
+        shuffle_samples(samples, last - first, &epoch->rng[b]);
+        double error = 0.0;
+        for (size_t t = 0; t < last - first; t++) {
+            error += sgd_step(epoch->model, epoch->params, samples[t].user, samples[t].item,
+                              samples[t].rating, u_old);
+        }
+        epoch->error[b] = error;
+    }
+}
+
+static double elapsed_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+// SGD sur samples (réordonné sur place). num_ratings est la taille de la
+// source, enregistrée dans le modèle.
+static mf_model_t* train_sgd(mf_sample_t *samples, size_t num_samples, size_t num_ratings,
+                                 size_t num_users, size_t num_items, const mf_params_t *params) {
+    size_t k = params->k;
+    size_t num_slices = pool_size(params->pool);
+    if (num_slices > num_samples) {
+        num_slices = num_samples ? num_samples : 1;
+    }
+
+    mf_model_t *model = model_alloc(num_users, num_items, k, params->seed);
+    uint64_t *rng = malloc(num_slices * sizeof(uint64_t));
+    double *u_old = malloc(num_slices * k * sizeof(double));
+    double *error = calloc(num_slices, sizeof(double));
+    if (model == NULL || rng == NULL || u_old == NULL || error == NULL) {
+        mf_model_free(model);
+        free(rng);
+        free(u_old);
+        free(error);
+        return NULL;
+    }
+
+    // Mélange global une fois (répartition des notes entre tranches), puis
+    // un mélange par tranche et par époque
+    uint64_t global = rng_init(params->seed, 1);
+    shuffle_samples(samples, num_samples, &global);
+    for (size_t b = 0; b < num_slices; b++) {
+        rng[b] = rng_init(params->seed, 2 + b);
+    }
+
+    hogwild_epoch_t epoch = { model, params, samples, num_samples, num_slices, rng, u_old, error };
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t e = 0; e < params->epochs; e++) {
+        struct timespec epoch_start;
+        clock_gettime(CLOCK_MONOTONIC, &epoch_start);
+        pool_parallel_for(params->pool, num_slices, 1, hogwild_slices, &epoch);
+
+        double total_error = 0.0;
+        for (size_t b = 0; b < num_slices; b++) {
+            total_error += error[b];
+        }
+        double seconds = elapsed_since(&epoch_start);
+        if (num_samples > 0) {
+            printf("Époque %zu/%zu - RMSE: %.4f - %.2f M maj/s\n", e + 1, params->epochs,
+                   sqrt(total_error / num_samples), seconds > 0 ? num_samples / seconds * 1e-6 : 0.0);
+        }
+    }
+    printf("Entraînement: %.3f s, %zu époques, %zu thread(s)\n", elapsed_since(&start), params->epochs,
+           num_slices);
+
+    free(rng);
+    free(u_old);
+    free(error);
+    if (finish_training(model, num_ratings, params) != 0) {
+        mf_model_free(model);
+        return NULL;
+    }
+    return model;
+}
+
+// ========== ALS ==========
+
+// Une demi-itération : pour chaque ligne r de view (users ou items), x = [X[r], xb[r]]
+// résout (sum y.y^T + lambda.n_r.I) x = sum (note - yb[c]) y, avec y = [Y[c], 1]
+// pour chaque colonne c de la ligne. Les lignes sont indépendantes : elles
+// ne lisent que Y et yb, figés pendant la demi-itération.
+typedef struct {
+    const sparse_view_t *view;
+    ndarray_t *X, *xb;       // facteurs et biais résolus
+    const ndarray_t *Y, *yb; // facteurs et biais de l'autre côté
+    size_t k;
+    double lambda;
+    double *scratch;         // (k+1)^2 + (k+1) doubles par worker
+    double *error;           // erreur au carré par worker (NULL : non calculée)
+} als_step_t;
+
+// Résout A x = b (A symétrique définie positive, n x n) par Cholesky ;
+// A est écrasée, x remplace b. Retourne -1 si A n'est pas définie positive.
+static int cholesky_solve(double *A, double *b, size_t n) {
+    for (size_t j = 0; j < n; j++) {
+        double d = A[j * n + j];
+        for (size_t p = 0; p < j; p++) {
+            d -= A[j * n + p] * A[j * n + p];
+        }
+        if (d <= 1e-12) {
+            return -1;
+        }
+        A[j * n + j] = sqrt(d);
+        for (size_t i = j + 1; i < n; i++) {
+            double v = A[i * n + j];
+            for (size_t p = 0; p < j; p++) {
+                v -= A[i * n + p] * A[j * n + p];
+            }
+            A[i * n + j] = v / A[j * n + j];
+        }
+    }
+    // L y = b puis L^T x = y
+    for (size_t i = 0; i < n; i++) {
+        for (size_t p = 0; p < i; p++) {
+            b[i] -= A[i * n + p] * b[p];
+        }
+        b[i] /= A[i * n + i];
+    }
+    for (size_t i = n; i-- > 0;) {
+        for (size_t p = i + 1; p < n; p++) {
+            b[i] -= A[p * n + i] * b[p];
+        }
+        b[i] /= A[i * n + i];
+    }
+    return 0;
+}
+
+static void als_rows(void *arg, size_t begin, size_t end, size_t worker) {
+    als_step_t *step = arg;
+    const sparse_view_t *view = step->view;
+    size_t k = step->k, d = k + 1;
+    double *A = step->scratch + worker * (d * d + d);
+    double *b = A + d * d;
+    double error = 0.0;
+
+    for (size_t r = begin; r < end; r++) {
+        uint64_t first = view->offsets[r], last = view->offsets[r + 1];
+        double *x = step->X->data[r];
+        if (first == last) {
+            // Sans note, la solution régularisée est nulle
+            memset(x, 0, k * sizeof(double));
+            step->xb->data[r][0] = 0.0;
+            continue;
+        }
+
+        memset(A, 0, d * d * sizeof(double));
+        memset(b, 0, d * sizeof(double));
+        for (uint64_t e = first; e < last; e++) {
+            uint32_t c = view->index[e];
+            const double *y = step->Y->data[c];
+            double target = view->value[e] / 10.0 - step->yb->data[c][0];
+            // Triangle inférieur seulement, le dernier terme de y vaut 1
+            for (size_t i = 0; i < k; i++) {
+                for (size_t j = 0; j <= i; j++) {
+                    A[i * d + j] += y[i] * y[j];
+                }
+                A[k * d + i] += y[i];
+                b[i] += target * y[i];
+            }
+            A[k * d + k] += 1.0;
+            b[k] += target;
+        }
+        double reg = step->lambda * (double)(last - first);
+        for (size_t i = 0; i < d; i++) {
+            A[i * d + i] += reg;
+        }
+
+        if (cholesky_solve(A, b, d) == 0) {
+            memcpy(x, b, k * sizeof(double));
+            step->xb->data[r][0] = b[k];
+        }
+
+        if (step->error != NULL) {
+            for (uint64_t e = first; e < last; e++) {
+                uint32_t c = view->index[e];
+                double pred = step->xb->data[r][0] + step->yb->data[c][0] + kernel_dot(x, step->Y->data[c], k);
+                double err = view->value[e] / 10.0 - pred;
+                error += err * err;
+            }
+        }
+    }
+    if (step->error != NULL) {
+        step->error[worker] += error;
+    }
+}
+
+// ALS sur les vues CSR (users) et CSC (items) de store
+static mf_model_t* train_als(const rating_store_t *store, size_t num_ratings, const mf_params_t *params) {
+    size_t k = params->k, d = k + 1;
+    size_t workers = pool_size(params->pool);
+    mf_model_t *model = model_alloc(store->num_users, store->num_items, k, params->seed);
+    double *scratch = malloc(workers * (d * d + d) * sizeof(double));
+    double *error = malloc(workers * sizeof(double));
+    if (model == NULL || scratch == NULL || error == NULL) {
+        mf_model_free(model);
+        free(scratch);
+        free(error);
+        return NULL;
+    }
+
+    als_step_t users = { &store->by_user, &model->U, &model->O, &model->V, &model->P, k, params->lambda,
+                         scratch, NULL };
+    // L'erreur d'entraînement est mesurée pendant la demi-itération items,
+    // avec les facteurs users à jour
+    als_step_t items = { &store->by_item, &model->V, &model->P, &model->U, &model->O, k, params->lambda,
+                         scratch, error };
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t it = 0; it < params->epochs; it++) {
+        struct timespec sweep_start;
+        clock_gettime(CLOCK_MONOTONIC, &sweep_start);
+        memset(error, 0, workers * sizeof(double));
+        pool_parallel_for(params->pool, store->num_users, MF_ALS_GRAIN, als_rows, &users);
+        pool_parallel_for(params->pool, store->num_items, MF_ALS_GRAIN, als_rows, &items);
+
+        double total_error = 0.0;
+        for (size_t w = 0; w < workers; w++) {
+            total_error += error[w];
+        }
+        if (store->nnz > 0) {
+            printf("Itération ALS %zu/%zu - RMSE: %.4f - %.3f s\n", it + 1, params->epochs,
+                   sqrt(total_error / store->nnz), elapsed_since(&sweep_start));
+        }
+    }
+    printf("Entraînement ALS: %.3f s, %zu itérations, %zu thread(s)\n", elapsed_since(&start), params->epochs,
+           workers);
+
+    free(scratch);
+    free(error);
+    if (finish_training(model, num_ratings, params) != 0) {
+        mf_model_free(model);
+        return NULL;
+    }
+    return model;
+}
+
+int mf_fold_in_user(mf_model_t *model, size_t user, const uint32_t *items, const float *ratings, size_t n,
+                    double lambda) {
+    size_t k = model->k, d = k + 1;
+    double *A = malloc((d * d + d) * sizeof(double));
+    if (A == NULL || grow_users(model, user + 1) != 0) {
+        free(A);
+        return -1;
+    }
+    double *b = A + d * d;
+
+    // Même système que la demi-itération users de l'ALS, avec les facteurs
+    // items compactés ; les items inconnus du modèle sont ignorés
+    memset(A, 0, (d * d + d) * sizeof(double));
+    size_t known = 0;
+    for (size_t t = 0; t < n; t++) {
+        if (items[t] >= model->num_items) {
+            continue;
+        }
+        const float *y = model->item_factors + (size_t)items[t] * model->stride;
+        double target = ratings[t] - model->item_bias[items[t]];
+        for (size_t i = 0; i < k; i++) {
+            for (size_t j = 0; j <= i; j++) {
+                A[i * d + j] += (double)y[i] * y[j];
+            }
+            A[k * d + i] += y[i];
+            b[i] += target * y[i];
+        }
+        A[k * d + k] += 1.0;
+        b[k] += target;
+        known++;
+    }
+    for (size_t i = 0; i < d; i++) {
+        A[i * d + i] += lambda * (known ? known : 1);
+    }
+
+    float *u = model->user_factors + user * model->stride;
+    int rc = known == 0 ? 0 : cholesky_solve(A, b, d);
+    if (rc == 0) {
+        for (size_t i = 0; i < k; i++) {
+            u[i] = known ? (float)b[i] : 0.0f;
+        }
+        model->user_bias[user] = known ? (float)b[k] : 0.0f;
+    }
+    free(A);
+    return rc;
+}
+
+// Entraîne avec le solveur de params. ALS construit d'abord les vues
+// CSR/CSC des notes (un doublon (user, item) garde la dernière note).
+static mf_model_t* train_samples(mf_sample_t *samples, size_t num_samples, size_t num_ratings,
+                                 size_t num_users, size_t num_items, const mf_params_t *params) {
+    if (params->solver != MF_SOLVER_ALS) {
+        return train_sgd(samples, num_samples, num_ratings, num_users, num_items, params);
+    }
+
+    size_t n = num_samples ? num_samples : 1;
+    uint32_t *users = malloc(n * sizeof(uint32_t));
+    uint32_t *items = malloc(n * sizeof(uint32_t));
+    uint8_t *values = malloc(n * sizeof(uint8_t));
+    rating_store_t store;
+    memset(&store, 0, sizeof(store));
+    mf_model_t *model = NULL;
+    if (users != NULL && items != NULL && values != NULL) {
+        for (size_t t = 0; t < num_samples; t++) {
+            double v = samples[t].rating * 10.0 + 0.5;
+            users[t] = samples[t].user;
+            items[t] = samples[t].item;
+            values[t] = (uint8_t)(v < 0.0 ? 0.0 : v > 255.0 ? 255.0 : v);
+        }
+        if (store_build(&store, users, items, values, num_samples, num_users, num_items) == 0) {
+            model = train_als(&store, num_ratings, params);
+            store_free(&store);
+        }
+    }
+    free(users);
+    free(items);
+    free(values);
+    return model;
+}
+
+mf_model_t* mf_train_samples(mf_sample_t *samples, size_t num_samples, size_t num_users,
+                             size_t num_items, const mf_params_t *params) {
+    if (check_dimensions(num_users, num_items, params) != 0) {
+        return NULL;
+    }
+    return train_samples(samples, num_samples, num_samples, num_users, num_items, params);
+}
+
+mf_model_t* mf_train_store(const rating_store_t *store, const mf_params_t *params) {
+    if (check_dimensions(store->num_users, store->num_items, params) != 0) {
+        return NULL;
+    }
+    if (params->solver == MF_SOLVER_ALS) {
+        return train_als(store, store->nnz, params);
+    }
+
+    // SGD : une note par entrée de la vue CSR
+    mf_sample_t *samples = malloc((store->nnz ? store->nnz : 1) * sizeof(mf_sample_t));
+    if (samples == NULL) {
+        return NULL;
+    }
+    const sparse_view_t *view = &store->by_user;
+    for (size_t u = 0; u < view->n_rows; u++) {
+        for (uint64_t e = view->offsets[u]; e < view->offsets[u + 1]; e++) {
+            samples[e].user = (uint32_t)u;
+            samples[e].item = view->index[e];
+            samples[e].rating = view->value[e] / 10.0f;
+        }
+    }
+    mf_model_t *model = train_sgd(samples, store->nnz, store->nnz, store->num_users, store->num_items, params);
+    free(samples);
+    return model;
+}
+
+mf_model_t* mf_train(const Transaction* transactions, size_t num_transactions, size_t num_users,
+                     size_t num_items, const mf_params_t *params) {
+    if (check_dimensions(num_users, num_items, params) != 0) {
+        return NULL;
+    }
+    mf_sample_t *samples = malloc((num_transactions ? num_transactions : 1) * sizeof(mf_sample_t));
+    if (samples == NULL) {
+        return NULL;
+    }
+
+    size_t n = 0;
+    for (size_t t = 0; t < num_transactions; t++) {
+        if (transactions[t].user_id < num_users && transactions[t].item_id < num_items) {
+            samples[n].user = (uint32_t)transactions[t].user_id;
+            samples[n].item = (uint32_t)transactions[t].item_id;
+            samples[n].rating = (float)transactions[t].rating;
+            n++;
+        }
+    }
+
+    mf_model_t *model = train_samples(samples, n, num_transactions, num_users, num_items, params);
+    free(samples);
+    return model;
+}
+
+mf_model_t* mf_train_log(const rating_log_t *log, size_t num_users, size_t num_items,
+                         const mf_params_t *params) {
+    if (check_dimensions(num_users, num_items, params) != 0) {
+        return NULL;
+    }
+    mf_sample_t *samples = malloc((log->size ? log->size : 1) * sizeof(mf_sample_t));
+    if (samples == NULL) {
+        return NULL;
+    }
+
+    size_t n = 0;
+    for (size_t s = 0; s < rating_log_num_segments(log); s++) {
+        rating_columns_t col = rating_log_segment(log, s);
+        for (size_t t = 0; t < col.len; t++) {
+            if (col.user[t] < num_users && col.item[t] < num_items) {
+                samples[n].user = col.user[t];
+                samples[n].item = col.item[t];
+                samples[n].rating = col.rating[t] / 10.0f;
+                n++;
+            }
+        }
+    }
+
+    mf_model_t *model = train_samples(samples, n, log->size, num_users, num_items, params);
+    free(samples);
+    return model;
+}
+
+mf_model_t* mf_train_file(const char* train_data, size_t batch_size, const mf_params_t *params,
+                          id_map_t *users, id_map_t *items) {
     // Charger les données d'entraînement avec ndmath
     ndarray_t train_array = load_ndarray(train_data, batch_size);
     if (!train_array.data) {
         printf("Erreur: échec du chargement des données depuis %s\n", train_data);
-        ndarray_t empty = {0};
-        return empty;
+        return NULL;
     }
     
     printf("Données chargées: %zu lignes x %zu colonnes\n", train_array.shape[0], train_array.shape[1]);
 
     // Convertir en tableau de transactions
     size_t num_transactions;
-    Transaction* transactions = ndarray_to_transactions(train_array, &num_transactions);
+    Transaction* transactions = ndarray_to_transactions(train_array, &num_transactions, users, items);
+    free_array(&train_array);
     if (!transactions) {
         printf("Erreur: échec de la conversion des transactions\n");
-        free_array(&train_array);
-        ndarray_t empty = {0};
-        return empty;
+        return NULL;
     }
 
-    // Trouver le nombre max d'utilisateurs et d'items
-    size_t max_users = 0, max_items = 0;
-    for (size_t i = 0; i < num_transactions; i++) {
-        if (transactions[i].user_id + 1 > max_users) max_users = transactions[i].user_id + 1;
-        if (transactions[i].item_id + 1 > max_items) max_items = transactions[i].item_id + 1;
-    }
-    printf("max_users: %zu, max_items: %zu, k: %zu\n", max_users, max_items, k);
-    
-    if (max_users == 0 || max_items == 0 || k == 0) {
-        printf("Erreur: dimensions invalides (max_users=%zu, max_items=%zu, k=%zu)\n", max_users, max_items, k);
-        free(transactions);
-        free_array(&train_array);
-        ndarray_t empty = {0};
-        return empty;
+    // Les dimensions sont celles des dictionnaires, pas l'identifiant maximal
+    printf("max_users: %zu, max_items: %zu, k: %zu\n", users->size, items->size, params->k);
+    mf_model_t *model = mf_train(transactions, num_transactions, users->size, items->size, params);
+    free(transactions);
+    return model;
+}
+
+static uint64_t align_up(uint64_t x) {
+    return (x + MF_MODEL_ALIGN - 1) & ~(uint64_t)(MF_MODEL_ALIGN - 1);
+}
+
+// Calcule la taille et la position de chaque section à partir des dimensions de l'en-tête
+static void layout(mf_model_header_t *h) {
+    uint64_t *size = h->section_size;
+
+    size[MF_SEC_USER_IDS] = h->num_users * sizeof(uint64_t);
+    size[MF_SEC_ITEM_IDS] = h->num_items * sizeof(uint64_t);
+    size[MF_SEC_USER_FACTORS] = h->num_users * h->stride * sizeof(float);
+    size[MF_SEC_ITEM_FACTORS] = h->num_items * h->stride * sizeof(float);
+    size[MF_SEC_USER_BIAS] = h->num_users * sizeof(float);
+    size[MF_SEC_ITEM_BIAS] = h->num_items * sizeof(float);
+
+    uint64_t pos = align_up(sizeof(mf_model_header_t));
+    for (int s = 0; s < MF_NUM_SECTIONS; s++) {
+        h->section_offset[s] = pos;
+        pos = align_up(pos + size[s]);
     }
+    h->file_size = pos;
+}
 
-    // Initialiser les matrices U, V, O, P
-    srand(time(NULL));
-    printf("Création de U (%zu x %zu)\n", max_users, k);
-    ndarray_t U = array(max_users, k); // Facteurs latents utilisateurs
-    printf("Création de V (%zu x %zu)\n", max_items, k);
-    ndarray_t V = array(max_items, k); // Facteurs latents items
-    printf("Création de O (%zu x 1)\n", max_users);
-    ndarray_t O = array(max_users, 1); // Biais utilisateurs
-    printf("Création de P (%zu x 1)\n", max_items);
-    ndarray_t P = array(max_items, 1); // Biais items
-    
-    if (!U.data || !V.data || !O.data || !P.data) {
-        printf("Erreur: échec de l'allocation d'une matrice (U=%p, V=%p, O=%p, P=%p)\n",
-               (void*)U.data, (void*)V.data, (void*)O.data, (void*)P.data);
-        clean(&U, &V, &O, &P, NULL);
-        free(transactions);
-        free_array(&train_array);
-        ndarray_t empty = {0};
-        return empty;
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+// FNV-1a sur des mots de 64 bits (le corps du fichier est aligné sur 64 octets)
+static uint64_t checksum_words(uint64_t hash, const uint64_t *words, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        hash = (hash ^ words[i]) * FNV_PRIME;
     }
+    return hash;
+}
 
-    // Initialiser U et V avec des valeurs aléatoires entre 0 et 0.1
-    for (size_t i = 0; i < max_users; i++) {
-        for (size_t j = 0; j < k; j++) {
-            U.data[i][j] = ((double)rand() / RAND_MAX) * 0.1;
+static int write_at(FILE *f, uint64_t offset, const void *data, size_t size) {
+    static const char zeros[MF_MODEL_ALIGN];
+
+    long pos = ftell(f);
+    if (pos < 0 || (uint64_t)pos > offset) {
+        return -1;
+    }
+    while ((uint64_t)pos < offset) {
+        size_t pad = offset - pos < sizeof(zeros) ? offset - pos : sizeof(zeros);
+        if (fwrite(zeros, 1, pad, f) != pad) {
+            return -1;
         }
+        pos += pad;
     }
-    for (size_t i = 0; i < max_items; i++) {
-        for (size_t j = 0; j < k; j++) {
-            V.data[i][j] = ((double)rand() / RAND_MAX) * 0.1;
+    if (size > 0 && fwrite(data, 1, size, f) != size) {
+        return -1;
+    }
+    return 0;
+}
+
+// Relit le corps du fichier écrit pour en calculer le checksum
+static int checksum_file(FILE *f, const mf_model_header_t *h, uint64_t *checksum) {
+    uint64_t buffer[4096];
+    uint64_t pos = align_up(sizeof(mf_model_header_t));
+    uint64_t hash = FNV_OFFSET;
+
+    if (fflush(f) != 0 || fseek(f, (long)pos, SEEK_SET) != 0) {
+        return -1;
+    }
+    while (pos < h->file_size) {
+        size_t n = (h->file_size - pos) / sizeof(uint64_t);
+        if (n > sizeof(buffer) / sizeof(buffer[0])) {
+            n = sizeof(buffer) / sizeof(buffer[0]);
+        }
+        if (fread(buffer, sizeof(uint64_t), n, f) != n) {
+            return -1;
         }
+        hash = checksum_words(hash, buffer, n);
+        pos += n * sizeof(uint64_t);
     }
-    // Initialiser O et P à 0
-    for (size_t i = 0; i < max_users; i++) 
-        O.data[i][0] = 0.0;
-    for (size_t j = 0; j < max_items; j++) 
-        P.data[j][0] = 0.0;
+    *checksum = hash;
+    return 0;
+}
 
-    // Descente de gradient stochastique
-    printf("Début de l'entraînement (%zu époques)...\n", epochs);
-    for (size_t epoch = 0; epoch < epochs; epoch++) {
-        double total_error = 0.0;
-        
-        for (size_t t = 0; t < num_transactions; t++) {
-            size_t i = transactions[t].user_id;
-            size_t j = transactions[t].item_id;
-            double r_ij = transactions[t].rating;
-
-            // Calculer la prédiction
-            double r_hat_ij = O.data[i][0] + P.data[j][0];
-            for (size_t s = 0; s < k; s++) {
-                r_hat_ij += U.data[i][s] * V.data[j][s];
-            }
+int mf_model_save(const mf_model_t *model, const uint64_t *user_ids, const uint64_t *item_ids,
+                  const char *path) {
+    mf_model_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MF_MODEL_MAGIC, sizeof(MF_MODEL_MAGIC));
+    h.version = MF_MODEL_VERSION;
+    h.header_size = sizeof(mf_model_header_t);
+    h.num_users = model->num_users;
+    h.num_items = model->num_items;
+    h.k = model->k;
+    h.stride = model->stride;
+    h.num_ratings = model->num_ratings;
+    h.solver = model->params.solver;
+    h.epochs = model->params.epochs;
+    h.seed = model->params.seed;
+    h.alpha = model->params.alpha;
+    h.lambda = model->params.lambda;
+    layout(&h);
 
-            // Calculer l'erreur
-            double e_ij = r_ij - r_hat_ij;
-            total_error += e_ij * e_ij;
+    // Écriture dans un fichier temporaire puis renommage : un serveur qui
+    // démarre ne voit jamais de modèle à moitié écrit
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        return -1;
+    }
+    FILE *f = fopen(tmp_path, "w+b");
+    if (f == NULL) {
+        perror("Failed to create MF model file");
+        return -1;
+    }
 
-            // Mettre à jour O et P
-            O.data[i][0] += alpha * (e_ij - lambda * O.data[i][0]);
-            P.data[j][0] += alpha * (e_ij - lambda * P.data[j][0]);
+    const uint64_t *off = h.section_offset;
+    const uint64_t *size = h.section_size;
+    int rc = 0;
+    rc |= write_at(f, 0, &h, sizeof(h));
+    rc |= write_at(f, off[MF_SEC_USER_IDS], user_ids, size[MF_SEC_USER_IDS]);
+    rc |= write_at(f, off[MF_SEC_ITEM_IDS], item_ids, size[MF_SEC_ITEM_IDS]);
+    rc |= write_at(f, off[MF_SEC_USER_FACTORS], model->user_factors, size[MF_SEC_USER_FACTORS]);
+    rc |= write_at(f, off[MF_SEC_ITEM_FACTORS], model->item_factors, size[MF_SEC_ITEM_FACTORS]);
+    rc |= write_at(f, off[MF_SEC_USER_BIAS], model->user_bias, size[MF_SEC_USER_BIAS]);
+    rc |= write_at(f, off[MF_SEC_ITEM_BIAS], model->item_bias, size[MF_SEC_ITEM_BIAS]);
+    rc |= write_at(f, h.file_size, NULL, 0);
 
-            // Mettre à jour U et V
-            for (size_t s = 0; s < k; s++) {
-                double u_is = U.data[i][s];
-                U.data[i][s] += alpha * (e_ij * V.data[j][s] - lambda * u_is);
-                V.data[j][s] += alpha * (e_ij * u_is - lambda * V.data[j][s]);
-            }
+    // L'en-tête est réécrit avec le checksum du corps
+    if (rc == 0 && checksum_file(f, &h, &h.checksum) == 0 && fseek(f, 0, SEEK_SET) == 0) {
+        rc |= write_at(f, 0, &h, sizeof(h));
+    } else {
+        rc = -1;
+    }
+
+    if (fclose(f) != 0) {
+        rc = -1;
+    }
+    if (rc != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Error: Failed to write MF model %s\n", path);
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// Vérifie que l'en-tête décrit exactement le fichier projeté
+static int validate_header(const mf_model_header_t *h, size_t length) {
+    if (memcmp(h->magic, MF_MODEL_MAGIC, sizeof(MF_MODEL_MAGIC)) != 0) {
+        fprintf(stderr, "Error: Not an MF model file\n");
+        return -1;
+    }
+    if (h->version != MF_MODEL_VERSION || h->header_size != sizeof(mf_model_header_t)) {
+        fprintf(stderr, "Error: Unsupported MF model version %u\n", h->version);
+        return -1;
+    }
+    // Aucune section n'est vide : toutes commencent avant la fin du fichier
+    if (h->num_users == 0 || h->num_items == 0 || h->k == 0 || h->k > UINT32_MAX ||
+        h->stride != (h->k + MF_ROW_ALIGN - 1) / MF_ROW_ALIGN * MF_ROW_ALIGN ||
+        h->num_users > UINT32_MAX || h->num_items > UINT32_MAX ||
+        (h->solver != MF_SOLVER_SGD && h->solver != MF_SOLVER_ALS)) {
+        fprintf(stderr, "Error: Corrupted MF model header\n");
+        return -1;
+    }
+    // Les facteurs tiennent dans le fichier : les produits calculés par
+    // layout() ne peuvent pas déborder
+    if (h->num_users > length / sizeof(float) / h->stride || h->num_items > length / sizeof(float) / h->stride) {
+        fprintf(stderr, "Error: MF model layout does not match its header\n");
+        return -1;
+    }
+
+    mf_model_header_t expected = *h;
+    layout(&expected);
+    if (h->file_size != length || expected.file_size != length ||
+        memcmp(expected.section_offset, h->section_offset, sizeof(h->section_offset)) != 0 ||
+        memcmp(expected.section_size, h->section_size, sizeof(h->section_size)) != 0) {
+        fprintf(stderr, "Error: MF model layout does not match its header\n");
+        return -1;
+    }
+    return 0;
+}
+
+int mf_model_verify(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror("Failed to open MF model file");
+        return -1;
+    }
+
+    mf_model_header_t h;
+    uint64_t checksum = 0;
+    long length = -1;
+    int rc = fread(&h, sizeof(h), 1, f) == 1 && fseek(f, 0, SEEK_END) == 0 ? 0 : -1;
+    if (rc == 0) {
+        length = ftell(f);
+    }
+    if (rc != 0 || length < 0 || validate_header(&h, (size_t)length) != 0 ||
+        checksum_file(f, &h, &checksum) != 0) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    if (checksum != h.checksum) {
+        fprintf(stderr, "Error: MF model checksum mismatch\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Lignes du fichier (identifiants ids, rows lignes de width floats)
+// réindexées selon map. Sans map, ou si map indexe déjà les lignes dans le
+// même ordre, les lignes du fichier sont utilisées telles quelles ; sinon
+// elles sont recopiées dans des lignes allouées.
+static int attach_rows(const id_map_t *map, const uint64_t *ids, size_t rows, size_t width,
+                       float *factors, float *bias, float **out_factors, float **out_bias, size_t *out_rows) {
+    int same = 1;
+    for (size_t r = 0; map != NULL && r < rows && same; r++) {
+        same = id_map_find(map, ids[r]) == r;
+    }
+    if (same) {
+        *out_factors = factors;
+        *out_bias = bias;
+        *out_rows = rows;
+        return 0;
+    }
+
+    size_t n = map->size;
+    *out_factors = alloc_rows(n, width);
+    *out_bias = alloc_rows(n, 1);
+    if (*out_factors == NULL || *out_bias == NULL) {
+        free(*out_factors);
+        free(*out_bias);
+        *out_factors = *out_bias = NULL;
+        return -1;
+    }
+    for (size_t r = 0; r < rows; r++) {
+        uint32_t dense = id_map_find(map, ids[r]);
+        if (dense == ID_MAP_NONE || dense >= n) {
+            continue;
         }
-        
-        // Afficher l'erreur toutes les 10 époques
-        if ((epoch + 1) % 10 == 0) {
-            double rmse = sqrt(total_error / num_transactions);
-            printf("Époque %zu/%zu - RMSE: %.4f\n", epoch + 1, epochs, rmse);
+        memcpy(*out_factors + (size_t)dense * width, factors + r * width, width * sizeof(float));
+        (*out_bias)[dense] = bias[r];
+    }
+    *out_rows = n;
+    return 0;
+}
+
+mf_model_t* mf_model_load(const char *path, const id_map_t *users, const id_map_t *items) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(mf_model_header_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    // Projection privée en écriture : mf_fold_in_user() peut modifier les
+    // lignes users sans toucher au fichier
+    size_t length = (size_t)st.st_size;
+    void *base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map MF model");
+        return NULL;
+    }
+
+    const mf_model_header_t *h = base;
+    mf_model_t *model = validate_header(h, length) == 0 ? calloc(1, sizeof(mf_model_t)) : NULL;
+    if (model == NULL) {
+        munmap(base, length);
+        return NULL;
+    }
+    model->mapping = base;
+    model->mapping_length = length;
+    model->refs = 1;
+    model->k = h->k;
+    model->stride = h->stride;
+    model->num_ratings = h->num_ratings;
+    model->params.k = h->k;
+    model->params.alpha = h->alpha;
+    model->params.lambda = h->lambda;
+    model->params.epochs = h->epochs;
+    model->params.seed = h->seed;
+    model->params.solver = (mf_solver_t)h->solver;
+
+    char *bytes = base;
+    const uint64_t *off = h->section_offset;
+    if (attach_rows(users, (const uint64_t *)(bytes + off[MF_SEC_USER_IDS]), h->num_users, h->stride,
+                    (float *)(bytes + off[MF_SEC_USER_FACTORS]), (float *)(bytes + off[MF_SEC_USER_BIAS]),
+                    &model->user_factors, &model->user_bias, &model->num_users) != 0 ||
+        attach_rows(items, (const uint64_t *)(bytes + off[MF_SEC_ITEM_IDS]), h->num_items, h->stride,
+                    (float *)(bytes + off[MF_SEC_ITEM_FACTORS]), (float *)(bytes + off[MF_SEC_ITEM_BIAS]),
+                    &model->item_factors, &model->item_bias, &model->num_items) != 0) {
+        fprintf(stderr, "Error: Failed to allocate MF model rows\n");
+        mf_model_free(model);
+        return NULL;
+    }
+    model->cap_users = model->num_users;
+    model->version = __atomic_add_fetch(&next_version, 1, __ATOMIC_RELAXED);
+    return model;
+}
+
+double mf_model_predict(const mf_model_t *model, size_t user, size_t item) {
+    return (double)model->user_bias[user] + model->item_bias[item] +
+           kernel_dot_f32(model->user_factors + user * model->stride,
+                          model->item_factors + item * model->stride, model->k);
+}
+
+static int check_items(const mf_model_t *model, const uint32_t *items, size_t num_items) {
+    if (items == NULL) {
+        return num_items <= model->num_items ? 0 : -1;
+    }
+    for (size_t j = 0; j < num_items; j++) {
+        if (items[j] >= model->num_items) {
+            return -1;
         }
     }
+    return 0;
+}
 
-    // Créer la matrice pleine R = U * V^T + O + P
-    printf("Création de V_T (transpose de V)\n");
-    ndarray_t V_T = transpose(&V);
-    printf("Création de R (%zu x %zu)\n", max_users, max_items);
-    ndarray_t R = array(max_users, max_items);
-    
-    if (!R.data || !V_T.data) {
-        printf("Erreur: échec de l'allocation de R ou V_T (R=%p, V_T=%p)\n", 
-               (void*)R.data, (void*)V_T.data);
-        clean(&U, &V, &O, &P, &V_T, NULL);
-        free(transactions);
-        free_array(&train_array);
-        ndarray_t empty = {0};
-        return empty;
+// Scores d'un user pour les items [begin, end) de la liste
+static void score_range(const mf_model_t *model, size_t user, const uint32_t *items, size_t begin,
+                        size_t end, float *scores) {
+    const float *u = model->user_factors + user * model->stride;
+    float bias = model->user_bias[user];
+    for (size_t j = begin; j < end; j++) {
+        size_t item = items ? items[j] : j;
+        scores[j] = bias + model->item_bias[item] +
+                    kernel_dot_f32(u, model->item_factors + item * model->stride, model->k);
+    }
+}
+
+int mf_score_user(const mf_model_t *model, size_t user, const uint32_t *items, size_t num_items,
+                  float *scores) {
+    if (model == NULL || user >= model->num_users || check_items(model, items, num_items) != 0) {
+        return -1;
     }
+    score_range(model, user, items, 0, num_items, scores);
+    return 0;
+}
 
-    // Calculer U * V^T manuellement
-    printf("Calcul de la matrice de recommandation finale...\n");
-    for (size_t i = 0; i < max_users; i++) {
-        for (size_t j = 0; j < max_items; j++) {
-            R.data[i][j] = 0.0;
-            for (size_t s = 0; s < k; s++) {
-                R.data[i][j] += U.data[i][s] * V_T.data[s][j];
-            }
-            R.data[i][j] += O.data[i][0] + P.data[j][0];
+int mf_score_users(const mf_model_t *model, const uint32_t *users, size_t num_users,
+                   const uint32_t *items, size_t num_items, float *scores) {
+    if (model == NULL || check_items(model, items, num_items) != 0) {
+        return -1;
+    }
+    for (size_t u = 0; u < num_users; u++) {
+        if (users[u] >= model->num_users) {
+            return -1;
         }
     }
 
-    // Nettoyage
-    clean(&U, &V, &O, &P, &V_T, NULL);
-    free(transactions);
-    free_array(&train_array);
-    
-    printf("Matrice de factorisation créée avec succès!\n");
-    return R;
+    for (size_t begin = 0; begin < num_items; begin += MF_SCORE_BLOCK) {
+        size_t end = num_items - begin > MF_SCORE_BLOCK ? begin + MF_SCORE_BLOCK : num_items;
+        for (size_t u = 0; u < num_users; u++) {
+            score_range(model, users[u], items, begin, end, scores + u * num_items);
+        }
+    }
+    return 0;
+}
+
+mf_model_t* MF(const char* train_data, size_t batch_size, size_t k, double alpha, double lambda, size_t epochs,
+               id_map_t *users, id_map_t *items) {
+    mf_params_t params = { k, alpha, lambda, epochs, NULL, 0, MF_SOLVER_SGD };
+    return mf_train_file(train_data, batch_size, &params, users, items);
 }
 
-ndarray_t Predict_all_MF(ndarray_t full_matrix, size_t batch_size, const char* test_data) {
+ndarray_t Predict_all_MF(const mf_model_t *model, size_t batch_size, const char* test_data,
+                         const id_map_t *users, const id_map_t *items) {
     // Charger les données de test avec ndmath
     ndarray_t test_array = load_ndarray(test_data, batch_size);
-    if (!test_array.data || full_matrix.shape[0] == 0 || full_matrix.shape[1] == 0) {
-        printf("Erreur: données de test invalides ou matrice vide\n");
+    if (!test_array.data || model == NULL) {
+        printf("Erreur: données de test invalides ou modèle absent\n");
         ndarray_t empty = {0};
         return empty;
     }
@@ -203,41 +1135,35 @@ ndarray_t Predict_all_MF(ndarray_t full_matrix, size_t batch_size, const char* t
     printf("Données de test chargées: %zu lignes x %zu colonnes\n", 
            test_array.shape[0], test_array.shape[1]);
 
-    // Convertir en tableau de transactions
-    size_t num_transactions;
-    Transaction* test_transactions = ndarray_to_transactions(test_array, &num_transactions);
-    if (!test_transactions) {
-        printf("Erreur: échec de la conversion des transactions de test\n");
-        free_array(&test_array);
-        ndarray_t empty = {0};
-        return empty;
-    }
+    size_t num_transactions = test_array.shape[0];
 
     // Créer une matrice pour stocker les prédictions
     printf("Création de predictions (%zu x 3)\n", num_transactions);
     ndarray_t predictions = array(num_transactions, 3);
     if (!predictions.data) {
-        free(test_transactions);
         free_array(&test_array);
         ndarray_t empty = {0};
         return empty;
     }
 
-    // Remplir les prédictions
+    // Remplir les prédictions (les identifiants inconnus à l'entraînement n'ont pas de facteurs)
     size_t valid_predictions = 0;
     for (size_t i = 0; i < num_transactions; i++) {
-        size_t user_id = test_transactions[i].user_id;
-        size_t item_id = test_transactions[i].item_id;
+        uint64_t external_user = (uint64_t)test_array.data[i][0];
+        uint64_t external_item = (uint64_t)test_array.data[i][1];
+        uint32_t user_id = id_map_find(users, external_user);
+        uint32_t item_id = id_map_find(items, external_item);
         
-        predictions.data[i][0] = (double)(user_id + 1); // Revenir à l'index 1
-        predictions.data[i][1] = (double)(item_id + 1); // Revenir à l'index 1
+        predictions.data[i][0] = (double)external_user;
+        predictions.data[i][1] = (double)external_item;
         
-        if (user_id < full_matrix.shape[0] && item_id < full_matrix.shape[1]) {
-            predictions.data[i][2] = full_matrix.data[user_id][item_id];
+        if (user_id < model->num_users && item_id < model->num_items) {
+            predictions.data[i][2] = mf_model_predict(model, user_id, item_id);
             valid_predictions++;
         } else {
             predictions.data[i][2] = 0.0; // Valeur par défaut si hors limites
-            printf("Attention: utilisateur %zu ou item %zu hors limites\n", user_id + 1, item_id + 1);
+            printf("Attention: utilisateur %llu ou item %llu inconnu\n",
+                   (unsigned long long)external_user, (unsigned long long)external_item);
         }
     }
 
@@ -252,7 +1178,6 @@ ndarray_t Predict_all_MF(ndarray_t full_matrix, size_t batch_size, const char* t
     }
 
     // Nettoyage
-    free(test_transactions);
     free_array(&test_array);
     
     return predictions;
@@ -2,8 +2,14 @@
 #define MF_H
 
 #include <ndmath/array.h>
+#include <core/id_map.h>
+#include <core/rating_log.h>
+#include <core/pool.h>
+#include <core/store.h>
+#include <core/topn.h>
 
-// Structure pour les transactions (compatible avec le format de traitement.c)
+// Structure pour les transactions (compatible avec le format de traitement.c).
+// user_id et item_id sont des index denses attribués par les dictionnaires d'identifiants.
 typedef struct {
     size_t user_id;
     size_t item_id;
@@ -11,13 +17,259 @@ typedef struct {
     double timestamp;
 } Transaction;
 
-// Fonction principale de factorisation matricielle
-extern ndarray_t MF(const char* train_data, size_t batch_size, size_t k, double alpha, double lambda, size_t epochs);
+// Les lignes compactées sont alignées sur 64 octets (16 floats)
+#define MF_ROW_ALIGN 16
+
+// Lignes par tâche dans une demi-itération ALS
+#define MF_ALS_GRAIN 16
+
+// Items traités par bloc dans mf_score_users() (facteurs gardés en cache)
+#define MF_SCORE_BLOCK 256
+
+// Itérations de k-means à la construction d'un index MIPS
+#define MF_MIPS_ITERATIONS 10
+
+struct MFMips;
+
+typedef enum {
+    MF_SOLVER_SGD,           // descente de gradient stochastique (Hogwild)
+    MF_SOLVER_ALS            // moindres carrés alternés
+} mf_solver_t;
+
+// Hyperparamètres de l'entraînement
+typedef struct MFParams {
+    size_t k;                // facteurs latents
+    double alpha;            // taux d'apprentissage (SGD seulement)
+    double lambda;           // régularisation
+    size_t epochs;           // époques SGD ou itérations ALS
+    thread_pool_t *pool;     // NULL : un seul thread
+    uint64_t seed;           // initialisation et mélanges ; 0 : graine par défaut
+    mf_solver_t solver;
+} mf_params_t;
+
+// Modèle entraîné : r(u, i) = O[u] + P[i] + <U[u], V[i]>. Entraîné une fois
+// puis partagé par les requêtes, qui ne font que du scoring. version est
+// unique et croissante dans le processus (permet de savoir quel modèle a servi).
+typedef struct MFModel {
+    // État de l'entraînement (sans les users ajoutés par mf_fold_in_user ;
+    // vide pour un modèle chargé par mf_model_load)
+    ndarray_t U;             // facteurs latents users (num_users x k)
+    ndarray_t V;             // facteurs latents items (num_items x k)
+    ndarray_t O;             // biais users (num_users x 1)
+    ndarray_t P;             // biais items (num_items x 1)
+    size_t num_users;
+    size_t num_items;
+    size_t k;
+
+    // Copie compacte en float32 utilisée pour le scoring : une ligne de
+    // stride floats par user/item (k complété par des zéros)
+    size_t stride;
+    float *user_factors;     // num_users x stride
+    float *item_factors;     // num_items x stride
+    float *user_bias;        // num_users
+    float *item_bias;        // num_items
+    size_t cap_users;        // lignes users allouées (mf_fold_in_user)
+
+    size_t num_ratings;      // transactions vues à l'entraînement
+    uint64_t version;
+    unsigned long refs;      // références (mf_model_retain / mf_model_release)
+    mf_params_t params;      // hyperparamètres de l'entraînement (sans le pool)
+    struct MFMips *mips;     // index des items (mf_mips_build), NULL : balayage complet
+
+    // Modèle chargé par mf_model_load() : fichier projeté, dont les lignes
+    // compactées peuvent faire partie
+    void *mapping;
+    size_t mapping_length;
+} mf_model_t;
+
+#define MF_MODEL_MAGIC "RECMFMD"
+#define MF_MODEL_VERSION 1
+#define MF_MODEL_ALIGN 64
+
+// Sections du fichier modèle, dans l'ordre où elles sont écrites
+typedef enum {
+    MF_SEC_USER_IDS,         // uint64 x num_users : identifiant externe de chaque ligne
+    MF_SEC_ITEM_IDS,         // uint64 x num_items
+    MF_SEC_USER_FACTORS,     // float x num_users x stride
+    MF_SEC_ITEM_FACTORS,     // float x num_items x stride
+    MF_SEC_USER_BIAS,        // float x num_users
+    MF_SEC_ITEM_BIAS,        // float x num_items
+    MF_NUM_SECTIONS
+} mf_section_t;
+
+// En-tête du fichier modèle. Chaque section commence sur MF_MODEL_ALIGN
+// octets : les facteurs sont utilisés directement depuis le mmap.
+typedef struct MFModelHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+    uint64_t checksum;       // FNV-1a des mots de 64 bits qui suivent l'en-tête
+    uint64_t num_users;
+    uint64_t num_items;
+    uint64_t k;
+    uint64_t stride;
+    uint64_t num_ratings;
+    // Hyperparamètres
+    uint32_t solver;
+    uint32_t reserved;
+    uint64_t epochs;
+    uint64_t seed;
+    double alpha;
+    double lambda;
+    uint64_t section_offset[MF_NUM_SECTIONS];
+    uint64_t section_size[MF_NUM_SECTIONS];
+} mf_model_header_t;
+
+// Index MIPS (produit scalaire maximal) des items d'un modèle, en listes
+// inversées. Chaque item est la ligne x = [V[i], P[i]] : le score d'un user
+// est O[u] + <[U[u], 1], x>. Avec M la plus grande norme, la ligne augmentée
+// [x, sqrt(M² - |x|²)] est de norme M pour tous les items : le plus grand
+// produit scalaire devient le plus proche voisin, et un k-means de ces
+// lignes les répartit en listes. Une recherche classe les listes par
+// produit scalaire de la requête avec leur centroïde, puis calcule le score
+// exact des items des nprobe meilleures (nprobe règle le rappel). Dans une
+// liste, les items sont triés par norme décroissante : le parcours s'arrête
+// dès que la borne de Cauchy-Schwarz ne peut plus entrer dans le top N.
+typedef struct MFMips {
+    size_t num_items;
+    size_t num_lists;
+    size_t k;
+    size_t stride;           // floats par ligne (k + 2 complété par des zéros)
+    float *centroids;        // num_lists x stride
+    uint64_t *offsets;       // num_lists + 1 : liste l = rangs [offsets[l], offsets[l + 1])
+    uint32_t *ids;           // item de chaque rang
+    float *rows;             // lignes augmentées, dans l'ordre des rangs
+    float *norms;            // |x| de chaque rang (sans la composante augmentée)
+} mf_mips_t;
+
+// Exclusion d'un item pour user (items déjà notés, par exemple)
+typedef int (*mf_exclude_t)(void *arg, size_t user, uint32_t item);
+
+// Emplacement du dernier modèle publié, lu sans verrou. Une structure mise
+// à zéro est un emplacement vide.
+typedef struct MFSlot {
+    mf_model_t *model;       // modèle publié (pointeur atomique)
+    unsigned long readers;   // lecteurs entre la lecture du pointeur et la prise de référence
+} mf_slot_t;
+
+// Note d'entraînement compacte, index denses
+typedef struct MFSample {
+    uint32_t user;
+    uint32_t item;
+    float rating;
+} mf_sample_t;
+
+// Entraîne un modèle sur des transactions en mémoire, d'index denses
+// < num_users / num_items (les autres sont ignorées), sur les threads de
+// params->pool. Retourne NULL en cas d'échec.
+// - MF_SOLVER_SGD : les notes sont mélangées à chaque époque et les threads
+//   mettent à jour le modèle sans verrou (Hogwild). RMSE et débit sont
+//   affichés à chaque époque.
+// - MF_SOLVER_ALS : chaque itération résout un système (k+1) x (k+1)
+//   (facteurs et biais) par user, puis par item, régularisé par lambda x
+//   nombre de notes. RMSE et durée sont affichés à chaque itération.
+extern mf_model_t* mf_train(const Transaction* transactions, size_t num_transactions, size_t num_users,
+                            size_t num_items, const mf_params_t *params);
+
+// Idem sur des notes déjà compactées (réordonnées sur place)
+extern mf_model_t* mf_train_samples(mf_sample_t *samples, size_t num_samples, size_t num_users,
+                                    size_t num_items, const mf_params_t *params);
+
+// Idem à partir des colonnes du journal des ratings (notes x10)
+extern mf_model_t* mf_train_log(const rating_log_t *log, size_t num_users, size_t num_items,
+                                const mf_params_t *params);
+
+// Idem directement sur les vues CSR/CSC d'un store (sans copie pour ALS)
+extern mf_model_t* mf_train_store(const rating_store_t *store, const mf_params_t *params);
+
+// Charge train_data puis appelle mf_train() ; les identifiants du fichier
+// sont ajoutés à users/items.
+extern mf_model_t* mf_train_file(const char* train_data, size_t batch_size, const mf_params_t *params,
+                                 id_map_t *users, id_map_t *items);
+extern void mf_model_free(mf_model_t *model);
+
+// Un modèle entraîné a une référence ; mf_model_release() le libère à la
+// dernière. Les deux acceptent NULL.
+extern mf_model_t* mf_model_retain(mf_model_t *model);
+extern void mf_model_release(mf_model_t *model);
+
+// Dernier modèle publié, avec une référence à rendre, ou NULL
+extern mf_model_t* mf_slot_acquire(mf_slot_t *slot);
+
+// Publie model (sa référence passe à l'emplacement ; NULL vide l'emplacement)
+// et rend celle du modèle remplacé, une fois qu'aucun lecteur ne peut plus
+// le prendre. Un seul publieur à la fois.
+extern void mf_slot_publish(mf_slot_t *slot, mf_model_t *model);
+
+// Note prédite pour (user, item), index denses < num_users / num_items
+extern double mf_model_predict(const mf_model_t *model, size_t user, size_t item);
+
+// Scores de user pour num_items items : les index de items, ou les items
+// 0 .. num_items - 1 si items est NULL. scores[j] correspond au j-ième item.
+// Retourne -1 si user ou un item est hors du modèle.
+extern int mf_score_user(const mf_model_t *model, size_t user, const uint32_t *items, size_t num_items,
+                         float *scores);
+
+// Idem pour un lot de users : scores[u * num_items + j]. Les items sont
+// parcourus par blocs de MF_SCORE_BLOCK, partagés par tous les users du lot.
+extern int mf_score_users(const mf_model_t *model, const uint32_t *users, size_t num_users,
+                          const uint32_t *items, size_t num_items, float *scores);
+
+// Recalcule le vecteur et le biais de user à partir de toutes ses notes
+// (items denses, notes sur 5), items figés : une résolution du système ALS
+// (k+1) x (k+1), sans réentraîner le reste. Un user au-delà de num_users
+// agrandit le modèle. Le modèle publié est modifié en place : l'appelant
+// doit exclure les autres lecteurs de ses lignes users. Retourne 0 ou -1.
+extern int mf_fold_in_user(mf_model_t *model, size_t user, const uint32_t *items, const float *ratings, size_t n,
+                           double lambda);
+
+// Écrit le modèle : user_ids[r] (resp. item_ids) est l'identifiant externe
+// de la ligne r. Écriture dans un fichier temporaire puis renommage.
+// Retourne 0 en cas de succès, -1 sinon.
+extern int mf_model_save(const mf_model_t *model, const uint64_t *user_ids, const uint64_t *item_ids,
+                         const char *path);
+
+// Projette un fichier modèle. Seuls l'en-tête et la taille du fichier sont
+// vérifiés, le checksum du corps ne l'est pas (voir mf_model_verify()) : le
+// chargement ne dépend pas de la taille des facteurs. Si users/items sont
+// donnés, les lignes sont réindexées selon ces dictionnaires : les facteurs restent
+// dans la projection quand l'indexation est déjà la même, sinon ils sont
+// recopiés (lignes absentes du fichier à zéro). La projection est privée :
+// les pages non modifiées sont partagées entre processus, mf_fold_in_user()
+// ne copie que celles qu'il touche. Retourne NULL en cas d'échec.
+extern mf_model_t* mf_model_load(const char *path, const id_map_t *users, const id_map_t *items);
+
+// Relit tout le fichier et compare son checksum à celui de l'en-tête
+// (O(taille du fichier), pour les outils). Retourne 0 si le fichier est intact.
+extern int mf_model_verify(const char *path);
+
+// Construit l'index des items de model en num_lists listes (0 : environ
+// racine du nombre d'items), affectations réparties sur pool (peut être
+// NULL). Les items d'un modèle ne changent plus après l'entraînement :
+// l'index peut être rangé dans model->mips, libéré avec le modèle.
+// Retourne NULL en cas d'échec.
+extern mf_mips_t* mf_mips_build(const mf_model_t *model, size_t num_lists, thread_pool_t *pool);
+extern void mf_mips_free(mf_mips_t *index);
+
+// Pousse dans top les items de meilleur score pour user parmi les nprobe
+// listes les plus prometteuses (nprobe >= num_lists : résultat exact), sauf
+// ceux que exclude (peut être NULL) écarte. Retourne le nombre d'items dont
+// le score a été calculé, ou -1 si user est hors du modèle.
+extern long mf_mips_search(const mf_mips_t *index, const mf_model_t *model, size_t user, size_t nprobe,
+                           mf_exclude_t exclude, void *arg, topn_t *top);
+
+// Fonction principale de factorisation matricielle : entraîne un modèle sur
+// train_data. Les identifiants du fichier sont ajoutés à users/items.
+extern mf_model_t* MF(const char* train_data, size_t batch_size, size_t k, double alpha, double lambda, size_t epochs,
+                      id_map_t *users, id_map_t *items);
 
 // Fonction de prédiction pour toutes les données de test
-extern ndarray_t Predict_all_MF(ndarray_t full_matrix, size_t batch_size, const char* test_data);
+extern ndarray_t Predict_all_MF(const mf_model_t *model, size_t batch_size, const char* test_data,
+                                const id_map_t *users, const id_map_t *items);
 
-// Fonction utilitaire pour convertir ndarray en transactions
-extern Transaction* ndarray_to_transactions(ndarray_t data, size_t* num_transactions);
+// Fonction utilitaire pour convertir ndarray en transactions (identifiants externes -> index denses)
+extern Transaction* ndarray_to_transactions(ndarray_t data, size_t* num_transactions,
+                                            id_map_t *users, id_map_t *items);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <core/kernels.h>
+#include "mf.h"
+
+// Items affectés par tâche pendant le k-means
+#define MIPS_GRAIN 256
+
+// Affectation de chaque ligne au centroïde le plus proche
+typedef struct {
+    const float *rows;       // lignes augmentées, dans l'ordre des items
+    const float *centroids;
+    const float *centroid_norms;  // |c|²
+    size_t num_lists;
+    size_t stride;
+    uint32_t *assign;
+} mips_assign_t;
+
+// Les lignes ayant toutes la même norme, |x - c|² = M² - 2 <x, c> + |c|²
+static void assign_rows(void *arg, size_t begin, size_t end, size_t worker) {
+    mips_assign_t *a = arg;
+    (void)worker;
+    for (size_t i = begin; i < end; i++) {
+        const float *x = a->rows + i * a->stride;
+        uint32_t best = 0;
+        float best_distance = INFINITY;
+        for (size_t l = 0; l < a->num_lists; l++) {
+            float distance = a->centroid_norms[l] - 2.0f * kernel_dot_f32(x, a->centroids + l * a->stride, a->stride);
+            if (distance < best_distance) {
+                best_distance = distance;
+                best = (uint32_t)l;
+            }
+        }
+        a->assign[i] = best;
+    }
+}
+
+typedef struct {
+    float norm;
+    uint32_t item;
+} mips_entry_t;
+
+// Norme décroissante, puis item croissant (ordre déterministe)
+static int compare_entries(const void *a, const void *b) {
+    const mips_entry_t *x = a, *y = b;
+    if (x->norm != y->norm) {
+        return x->norm < y->norm ? 1 : -1;
+    }
+    return x->item < y->item ? -1 : x->item > y->item;
+}
+
+static float *alloc_floats(size_t n) {
+    return calloc(n ? n : 1, sizeof(float));
+}
+
+void mf_mips_free(mf_mips_t *index) {
+    if (index == NULL) {
+        return;
+    }
+    free(index->centroids);
+    free(index->offsets);
+    free(index->ids);
+    free(index->rows);
+    free(index->norms);
+    free(index);
+}
+
+mf_mips_t* mf_mips_build(const mf_model_t *model, size_t num_lists, thread_pool_t *pool) {
+    size_t n = model->num_items, k = model->k;
+    if (num_lists == 0) {
+        num_lists = (size_t)sqrt((double)n);
+    }
+    if (num_lists > n) {
+        num_lists = n;
+    }
+    if (num_lists == 0) {
+        num_lists = 1;
+    }
+
+    mf_mips_t *index = calloc(1, sizeof(mf_mips_t));
+    if (index == NULL) {
+        return NULL;
+    }
+    index->num_items = n;
+    index->num_lists = num_lists;
+    index->k = k;
+    index->stride = (k + 2 + MF_ROW_ALIGN - 1) / MF_ROW_ALIGN * MF_ROW_ALIGN;
+    size_t s = index->stride;
+
+    float *rows = alloc_floats(n * s);
+    float *norms = alloc_floats(n);
+    float *centroid_norms = alloc_floats(num_lists);
+    double *sums = calloc(num_lists * s, sizeof(double));
+    size_t *counts = calloc(num_lists, sizeof(size_t));
+    uint32_t *assign = calloc(n ? n : 1, sizeof(uint32_t));
+    mips_entry_t *entries = malloc((n ? n : 1) * sizeof(mips_entry_t));
+    index->centroids = alloc_floats(num_lists * s);
+    index->offsets = calloc(num_lists + 1, sizeof(uint64_t));
+    index->ids = calloc(n ? n : 1, sizeof(uint32_t));
+    index->rows = alloc_floats(n * s);
+    index->norms = alloc_floats(n);
+    if (!rows || !norms || !centroid_norms || !sums || !counts || !assign || !entries || !index->centroids ||
+        !index->offsets || !index->ids || !index->rows || !index->norms) {
+        printf("Erreur: échec de l'allocation de l'index MIPS\n");
+        mf_mips_free(index);
+        index = NULL;
+        goto done;
+    }
+
+    // Lignes [V[i], P[i], sqrt(M² - |x|²)]
+    float max_norm = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        float *x = rows + i * s;
+        memcpy(x, model->item_factors + i * model->stride, k * sizeof(float));
+        x[k] = model->item_bias[i];
+        norms[i] = sqrtf(kernel_dot_f32(x, x, k + 1));
+        if (norms[i] > max_norm) {
+            max_norm = norms[i];
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        float rest = max_norm * max_norm - norms[i] * norms[i];
+        rows[i * s + k + 1] = rest > 0.0f ? sqrtf(rest) : 0.0f;
+    }
+
+    // k-means, centroïdes initiaux répartis sur tout le catalogue ; une
+    // liste vide garde son centroïde
+    for (size_t l = 0; l < num_lists; l++) {
+        memcpy(index->centroids + l * s, rows + (l * n / num_lists) * s, s * sizeof(float));
+    }
+    mips_assign_t a = { rows, index->centroids, centroid_norms, num_lists, s, assign };
+    for (size_t iter = 0; iter < MF_MIPS_ITERATIONS; iter++) {
+        for (size_t l = 0; l < num_lists; l++) {
+            const float *c = index->centroids + l * s;
+            centroid_norms[l] = kernel_dot_f32(c, c, s);
+        }
+        pool_parallel_for(pool, n, MIPS_GRAIN, assign_rows, &a);
+
+        memset(sums, 0, num_lists * s * sizeof(double));
+        memset(counts, 0, num_lists * sizeof(size_t));
+        for (size_t i = 0; i < n; i++) {
+            double *sum = sums + (size_t)assign[i] * s;
+            for (size_t j = 0; j < s; j++) {
+                sum[j] += rows[i * s + j];
+            }
+            counts[assign[i]]++;
+        }
+        for (size_t l = 0; l < num_lists; l++) {
+            for (size_t j = 0; counts[l] > 0 && j < s; j++) {
+                index->centroids[l * s + j] = (float)(sums[l * s + j] / counts[l]);
+            }
+        }
+    }
+    for (size_t l = 0; l < num_lists; l++) {
+        const float *c = index->centroids + l * s;
+        centroid_norms[l] = kernel_dot_f32(c, c, s);
+    }
+    pool_parallel_for(pool, n, MIPS_GRAIN, assign_rows, &a);
+
+    // Rangement par liste, chaque liste par norme décroissante
+    memset(counts, 0, num_lists * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) {
+        counts[assign[i]]++;
+    }
+    for (size_t l = 0; l < num_lists; l++) {
+        index->offsets[l + 1] = index->offsets[l] + counts[l];
+        counts[l] = index->offsets[l];
+    }
+    for (size_t i = 0; i < n; i++) {
+        entries[counts[assign[i]]++] = (mips_entry_t){ norms[i], (uint32_t)i };
+    }
+    for (size_t l = 0; l < num_lists; l++) {
+        qsort(entries + index->offsets[l], index->offsets[l + 1] - index->offsets[l], sizeof(mips_entry_t),
+              compare_entries);
+    }
+    for (size_t r = 0; r < n; r++) {
+        index->ids[r] = entries[r].item;
+        index->norms[r] = entries[r].norm;
+        memcpy(index->rows + r * s, rows + (size_t)entries[r].item * s, s * sizeof(float));
+    }
+
+done:
+    free(rows);
+    free(norms);
+    free(centroid_norms);
+    free(sums);
+    free(counts);
+    free(assign);
+    free(entries);
+    return index;
+}
+
+long mf_mips_search(const mf_mips_t *index, const mf_model_t *model, size_t user, size_t nprobe,
+                    mf_exclude_t exclude, void *arg, topn_t *top) {
+    if (user >= model->num_users || index->k != model->k) {
+        return -1;
+    }
+    size_t k = index->k, s = index->stride;
+    float *q = alloc_floats(s);
+    scored_id_t *lists = malloc(index->num_lists * sizeof(scored_id_t));
+    if (q == NULL || lists == NULL) {
+        free(q);
+        free(lists);
+        return -1;
+    }
+
+    // Requête [U[u], 1] : la composante augmentée des lignes ne compte pas
+    memcpy(q, model->user_factors + user * model->stride, k * sizeof(float));
+    q[k] = 1.0f;
+    double q_norm = sqrt(kernel_dot_f32(q, q, k + 1));
+    double user_bias = model->user_bias[user];
+
+    for (size_t l = 0; l < index->num_lists; l++) {
+        lists[l].id = (uint32_t)l;
+        lists[l].score = kernel_dot_f32(q, index->centroids + l * s, k + 1);
+    }
+    if (nprobe > index->num_lists) {
+        nprobe = index->num_lists;
+    }
+    nprobe = topn_select(lists, index->num_lists, nprobe);
+
+    // Les meilleures listes d'abord : le top N se remplit vite et la borne
+    // de Cauchy-Schwarz coupe tôt les listes suivantes
+    long scored = 0;
+    for (size_t p = 0; p < nprobe; p++) {
+        size_t l = lists[p].id;
+        for (uint64_t r = index->offsets[l]; r < index->offsets[l + 1]; r++) {
+            // Marge pour les arrondis du produit scalaire en float
+            double bound = user_bias + q_norm * index->norms[r] * (1.0 + 1e-5) + 1e-5;
+            if (!topn_accepts(top, 0, bound)) {
+                break;
+            }
+            uint32_t item = index->ids[r];
+            if (exclude != NULL && exclude(arg, user, item)) {
+                continue;
+            }
+            topn_push(top, item, user_bias + kernel_dot_f32(q, index->rows + r * s, k + 1));
+            scored++;
+        }
+    }
+
+    free(q);
+    free(lists);
+    return scored;
+}
@@ -29,6 +29,30 @@ pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
 int server_running = 1;
 recommendation_system_t rec_system;
 
+// Entraîneur MF en tâche de fond. Les requêtes lisent le dernier modèle
+// publié dans slot sans verrou et n'attendent jamais un entraînement. Le
+// même thread reconstruit l'index item-item quand le journal a grandi.
+static struct {
+    mf_slot_t slot;
+    thread_pool_t pool;          // workers de l'entraînement, distincts de ceux des requêtes
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    int started;
+    int requested;               // entraînement demandé par une requête
+    int item_knn_requested;      // index item-item périmé signalé par une requête
+    int stop;
+    unsigned long generation;    // données rechargées (protégé par data_mutex)
+} mf_trainer = { .mutex = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER };
+
+static void reset_rating_data();
+static void load_mf_model();
+static void start_mf_trainer();
+static void stop_mf_trainer();
+static void request_item_knn_rebuild();
+static int fold_in_mf_user(mf_model_t *model, uint32_t user);
+static int build_mf_mips(mf_model_t *model, thread_pool_t *pool);
+
 // Signal handler for graceful shutdown
 void signal_handler(int sig) {
     if (sig == SIGINT || sig == SIGTERM) {
@@ -56,6 +80,9 @@ void cleanup_server() {
     }
     pthread_mutex_unlock(&clients_mutex);
     pthread_mutex_destroy(&clients_mutex);
+    stop_mf_trainer();
+    reset_rating_data();
+    pool_free(&rec_system.pool);
     pthread_mutex_destroy(&rec_system.data_mutex);
     printf("Server cleanup completed\n");
 }
@@ -63,8 +90,20 @@ void cleanup_server() {
 int start_reco_server() {
     init_server();
     
-    // Load ratings data
-    load_ratings_data("server/data/ratings.txt");
+    // Noyaux vectoriels choisis une fois pour toutes selon le processeur
+    kernels_init();
+    log_message("Using %s kernels", kernels_name(kernels_isa()));
+    if (pool_init(&rec_system.pool, WORKER_THREADS) != 0) {
+        log_message("Failed to start worker pool, computing on one thread");
+    }
+    log_message("Worker pool: %zu threads", pool_size(&rec_system.pool));
+    
+    // Load ratings data : snapshot binaire si disponible, sinon fichier texte
+    if (load_snapshot(SNAPSHOT_FILE) != 0) {
+        load_ratings_data(RATINGS_FILE);
+    }
+    load_mf_model();
+    start_mf_trainer();
     
     // Create socket
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -190,7 +229,7 @@ void *handle_client(void *arg) {
         // Parse recommendation request
         recommendation_request_t req;
         int category_filter = -1;
-        int parsed = sscanf(buffer, "%d %d %d %d %d", 
+        int parsed = sscanf(buffer, "%ld %d %d %ld %d", 
                            &req.user_id, (int*)&req.algorithm, &req.k,
                            &req.num_recommendations, &category_filter);
         
@@ -222,11 +261,11 @@ void *handle_client(void *arg) {
 
 void format_recommendation_response(recommendation_request_t* req, recommendation_result_t* results, 
                                   int num_results, char* response) {
-    snprintf(response, MAX_MESSAGE_LENGTH, "RECOMMENDATIONS for user %d:\n", req->user_id);
+    snprintf(response, MAX_MESSAGE_LENGTH, "RECOMMENDATIONS for user %ld:\n", req->user_id);
     
     for (int i = 0; i < num_results; i++) {
         char temp[256];
-        snprintf(temp, sizeof(temp), "Item %d (Category %d): Rating %.2f\n",
+        snprintf(temp, sizeof(temp), "Item %ld (Category %ld): Rating %.2f\n",
                 results[i].item_id, results[i].category_id, results[i].predicted_rating);
         
         if (strlen(response) + strlen(temp) < MAX_MESSAGE_LENGTH - 1) {
@@ -280,132 +319,296 @@ void log_message(const char *format, ...) {
 
 void init_recommendation_system() {
     memset(&rec_system, 0, sizeof(rec_system));
-    
-    // Initialiser la matrice à -1
-    for (int i = 0; i < MAX_USERS; i++) {
-        for (int j = 0; j < MAX_ITEMS; j++) {
-            rec_system.user_item_matrix[i][j] = -1;
-        }
-    }
-    
     pthread_mutex_init(&rec_system.data_mutex, NULL);
     log_message("Recommendation system initialized\n");
 }
 
+// Reconstruit les vues CSR/CSC à partir du journal (data_mutex doit être tenu)
+static int rebuild_rating_store() {
+    rating_store_t store;
+    if (store_build_from_log(&store, &rec_system.log, rec_system.num_users, rec_system.num_items) != 0) {
+        log_message("Failed to build rating store");
+        return -1;
+    }
+
+    store_free(&rec_system.store);
+    rec_system.store = store;
+    rec_system.store_dirty = 0;
+    return 0;
+}
+
+// Encodage compact d'une note : x10 sur un octet (0-50)
+static uint8_t encode_rating(double rating) {
+    return (uint8_t)lround(rating * 10);
+}
+
+// Encodage compact d'un timestamp : secondes sur 32 bits non signés
+static uint32_t encode_timestamp(double timestamp) {
+    if (timestamp <= 0.0) return 0;
+    if (timestamp >= (double)UINT32_MAX) return UINT32_MAX;
+    return (uint32_t)timestamp;
+}
+
+// Met à jour le store si des ratings ont été ajoutés (data_mutex doit être tenu)
+static int refresh_rating_store() {
+    if (!rec_system.store_dirty) {
+        return 0;
+    }
+    return rebuild_rating_store();
+}
+
+static void reset_item_knn() {
+    if (rec_system.item_knn != NULL) {
+        item_knn_free(rec_system.item_knn);
+        free(rec_system.item_knn);
+        rec_system.item_knn = NULL;
+    }
+}
+
+// Amorce l'index item-item avec la table de bin/build_allpairs si elle a
+// été calculée sur les données chargées (data_mutex doit être tenu) ; sinon
+// l'entraîneur le construit en tâche de fond
+static void load_item_knn() {
+    item_knn_t *index = malloc(sizeof(item_knn_t));
+    if (index == NULL || item_knn_load(index, ITEM_PAIRS_FILE) != 0) {
+        free(index);
+        return;
+    }
+    if (rec_system.fingerprint == 0 || index->fingerprint != rec_system.fingerprint ||
+        index->num_items != rec_system.store.num_items || index->similarity != SIM_ADJUSTED_COSINE) {
+        log_message("Ignoring %s: built from other ratings", ITEM_PAIRS_FILE);
+        item_knn_free(index);
+        free(index);
+        return;
+    }
+    reset_item_knn();
+    rec_system.item_knn = index;
+    rec_system.item_knn_ratings = rec_system.log.size;
+    log_message("Loaded item-item KNN index from %s (M=%zu)", ITEM_PAIRS_FILE, index->m);
+}
+
+static void reset_knn_model() {
+    knn_model_free(rec_system.knn);
+    rec_system.knn = NULL;
+    if (rec_system.knn_table != NULL) {
+        knn_table_free(rec_system.knn_table);
+        free(rec_system.knn_table);
+        rec_system.knn_table = NULL;
+    }
+    if (rec_system.knn_hnsw != NULL) {
+        hnsw_free(rec_system.knn_hnsw);
+        free(rec_system.knn_hnsw);
+        rec_system.knn_hnsw = NULL;
+    }
+}
+
+// Charge l'index HNSW écrit par bin/build_knn_hnsw sur les profils du
+// modèle KNN (grands catalogues seulement ; data_mutex doit être tenu).
+// Jamais construit ici : sans index correspondant aux données, le KNN
+// reste exact.
+static void load_knn_hnsw() {
+    knn_model_t *model = rec_system.knn;
+    if (model->num_users < KNN_HNSW_MIN_USERS) {
+        return;
+    }
+
+    hnsw_t *index = malloc(sizeof(hnsw_t));
+    if (index == NULL || hnsw_load(index, KNN_HNSW_FILE, knn_model_distance, model) != 0) {
+        free(index);
+        return;
+    }
+    if (rec_system.fingerprint == 0 || index->fingerprint != rec_system.fingerprint ||
+        index->num_nodes != model->num_users) {
+        log_message("Ignoring %s: built from other ratings, using exact KNN", KNN_HNSW_FILE);
+        hnsw_free(index);
+        free(index);
+        return;
+    }
+    index->ef_search = KNN_HNSW_EF_SEARCH;
+    log_message("Loaded HNSW index over %zu users from %s (M=%zu, efSearch=%d)",
+                index->num_nodes, KNN_HNSW_FILE, index->m, KNN_HNSW_EF_SEARCH);
+    rec_system.knn_hnsw = index;
+}
+
+// Répercute dans l'index HNSW une note ajoutée par user : insertion des
+// nouveaux users, sinon recalcul des liens de user
+static int update_knn_hnsw(uint32_t user) {
+    hnsw_t *index = rec_system.knn_hnsw;
+    if (index == NULL) {
+        return 0;
+    }
+    if (user < index->num_nodes) {
+        return hnsw_update(index, user);
+    }
+    while (index->num_nodes < rec_system.knn->num_users) {
+        if (hnsw_insert(index, (uint32_t)index->num_nodes) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Construit le modèle KNN et sa table de voisins : celle du disque si elle
+// correspond aux données chargées, sinon une table dont les lignes seront
+// calculées à la première requête de chaque user (data_mutex doit être tenu).
+// En cas d'échec, ni le modèle ni la table ne restent en place.
+static int build_knn_model() {
+    rec_system.knn = knn_model_build(&rec_system.store);
+    if (rec_system.knn == NULL) {
+        log_message("Failed to initialize KNN model");
+        return -1;
+    }
+    rec_system.knn->pool = &rec_system.pool;
+
+    knn_table_t *table = malloc(sizeof(knn_table_t));
+    if (table == NULL) {
+        reset_knn_model();
+        return -1;
+    }
+    if (knn_table_load(table, KNN_TABLE_FILE) == 0) {
+        if (rec_system.fingerprint != 0 && table->fingerprint == rec_system.fingerprint &&
+            table->num_users == rec_system.knn->num_users) {
+            log_message("Loaded KNN neighbor table from %s (K=%zu)", KNN_TABLE_FILE, table->k);
+            rec_system.knn_table = table;
+            load_knn_hnsw();
+            return 0;
+        }
+        log_message("Ignoring %s: built from other ratings", KNN_TABLE_FILE);
+        knn_table_free(table);
+    }
+    if (knn_table_init(table, rec_system.knn->num_users, KNN_TABLE_K) != 0) {
+        free(table);
+        reset_knn_model();
+        return -1;
+    }
+    rec_system.knn_table = table;
+    load_knn_hnsw();
+    return 0;
+}
+
+// Libère les données chargées, y compris la projection du snapshot
+// (data_mutex doit être tenu, ou le serveur arrêté)
+static void reset_rating_data() {
+    reset_knn_model();
+    reset_item_knn();
+    // Un entraînement en cours sur les anciennes données ne sera pas publié
+    mf_trainer.generation++;
+    mf_slot_publish(&mf_trainer.slot, NULL);
+    store_free(&rec_system.store);
+    rating_log_free(&rec_system.log);
+    id_map_free(&rec_system.users);
+    id_map_free(&rec_system.items);
+    snapshot_close(&rec_system.snapshot);
+    rec_system.store_dirty = 0;
+    rec_system.fingerprint = 0;
+    rec_system.num_users = 0;
+    rec_system.num_items = 0;
+}
+
+// Charge un snapshot binaire : les données sont utilisées directement
+// depuis la projection mmap, sans parsing ni construction du store.
+// Les ratings ajoutés ensuite vont dans les chunks du journal. L'index
+// item-item est lu dans ITEM_PAIRS_FILE s'il correspond aux données, sinon
+// construit par l'entraîneur, jamais sous data_mutex.
+int load_snapshot(const char* filename) {
+    pthread_mutex_lock(&rec_system.data_mutex);
+
+    reset_rating_data();
+    if (snapshot_open(filename, &rec_system.snapshot, &rec_system.users, &rec_system.items,
+                      &rec_system.log, &rec_system.store) != 0 ||
+        (SNAPSHOT_VERIFY && snapshot_verify(&rec_system.snapshot) != 0)) {
+        reset_rating_data();
+        pthread_mutex_unlock(&rec_system.data_mutex);
+        log_message("No usable snapshot at %s", filename);
+        return -1;
+    }
+    rec_system.num_users = rec_system.users.size;
+    rec_system.num_items = rec_system.items.size;
+    rec_system.fingerprint = rec_system.snapshot.fingerprint;
+    build_knn_model();
+    load_item_knn();
+
+    pthread_mutex_unlock(&rec_system.data_mutex);
+
+    log_message("Mapped %zu ratings from %s (%ld users, %ld items)",
+                rec_system.log.size, filename, rec_system.num_users, rec_system.num_items);
+    return 0;
+}
+
 void load_ratings_data(const char* filename) {
     if (filename == NULL) {
         log_message("Error: Filename cannot be NULL");
         return;
     }
     
-    // Charger le fichier avec ndmath
-    ndarray_t data = load_ndarray(filename, 10);
-    
-    if (data.data == NULL) {
-        log_message("Error: Failed to load ratings data from %s", filename);
-        return;
-    }
-    
     pthread_mutex_lock(&rec_system.data_mutex);
     
     // Réinitialiser le système
-    memset(&rec_system.ratings, 0, sizeof(rec_system.ratings));
-    rec_system.num_ratings = 0;
-    rec_system.num_users = 0;
-    rec_system.num_items = 0;
+    reset_rating_data();
     
-    // Initialiser la matrice à -1
-    for (int i = 0; i < MAX_USERS; i++) {
-        for (int j = 0; j < MAX_ITEMS; j++) {
-            rec_system.user_item_matrix[i][j] = -1;
-        }
-    }
-    
-    size_t loaded_count = 0;
-    size_t total_rows = data.shape[0];
-    
-    for (size_t i = 0; i < total_rows && loaded_count < MAX_RATINGS; i++) {
-        // Format attendu: user_id, item_id, [category_id], rating , [timestamp]
-
-        int user_id = (int)data.data[i][0];
-        int item_id = (int)data.data[i][1];
-        int category_id = (int)data.data[i][2];
-        float rating = (float)data.data[i][3];
-        double timestamp = (double)data.data[i][3];
-
-        // Validation des données
-        if (user_id < 0 || user_id >= MAX_USERS || 
-            item_id < 0 || item_id >= MAX_ITEMS ||
-            rating < 0.0 || rating > 5.0) {
-            continue;
-        }
-        
-        // Ajouter le rating
-        rating_t *r = &rec_system.ratings[loaded_count];
-        r->user_id = user_id;
-        r->item_id = item_id;
-        r->category_id = category_id;
-        r->rating = rating;
-        r->timestamp = timestamp;
-        
-        // Mettre à jour la matrice
-        rec_system.user_item_matrix[user_id][item_id] = (int)(rating * 10); // Scale 0-50
-        
-        // Mettre à jour les compteurs max
-        if (user_id >= rec_system.num_users) {
-            rec_system.num_users = user_id + 1;
-        }
-        if (item_id >= rec_system.num_items) {
-            rec_system.num_items = item_id + 1;
-        }
-        
-        loaded_count++;
+    // Analyse parallèle du fichier, fusion directe dans le journal
+    ingest_stats_t stats;
+    if (ingest_ratings_file(filename, 0, &rec_system.users, &rec_system.items,
+                            &rec_system.log, &stats) != 0) {
+        log_message("Error: Failed to load ratings data from %s", filename);
     }
     
-    rec_system.num_ratings = loaded_count;
+    rec_system.num_users = rec_system.users.size;
+    rec_system.num_items = rec_system.items.size;
+    rec_system.fingerprint = dataset_fingerprint(&rec_system.users, &rec_system.items, &rec_system.log);
+    rebuild_rating_store();
+    build_knn_model();
+    load_item_knn();
     
     pthread_mutex_unlock(&rec_system.data_mutex);
     
-    // Libérer la mémoire du ndarray
-    free_array(&data);
-    
-    log_message("Loaded %zu ratings from %s (%d users, %d items)", 
-                loaded_count, filename, rec_system.num_users, rec_system.num_items);
+    log_message("Loaded %zu ratings from %s (%ld users, %ld items, %zu rejected lines)", 
+                stats.loaded, filename, rec_system.num_users, rec_system.num_items, stats.rejected);
 }
 
 
-int add_rating(int user_id, int item_id, int category_id, float rating) {
+int add_rating(long user_id, long item_id, int category_id, float rating) {
+    if (user_id < 0 || item_id < 0 || rating < 0.0 || rating > 5.0) {
+        return 0;
+    }
+
     pthread_mutex_lock(&rec_system.data_mutex);
     
-    if (rec_system.num_ratings >= MAX_RATINGS) {
+    uint32_t user = id_map_intern(&rec_system.users, (uint64_t)user_id);
+    uint32_t item = id_map_intern(&rec_system.items, (uint64_t)item_id);
+    if (user == ID_MAP_NONE || item == ID_MAP_NONE) {
         pthread_mutex_unlock(&rec_system.data_mutex);
         return 0;
     }
     
-    // Ajouter à la liste des ratings
-    rating_t *r = &rec_system.ratings[rec_system.num_ratings];
-    r->user_id = user_id;
-    r->item_id = item_id;
-    r->category_id = category_id;
-    r->rating = rating;
-
+    // Ajouter au journal des ratings
     time_t ti = time(NULL);
-    r->timestamp = (double)ti;
+    if (rating_log_append(&rec_system.log, user, item, (uint32_t)category_id,
+                          encode_rating(rating), encode_timestamp((double)ti)) != 0) {
+        pthread_mutex_unlock(&rec_system.data_mutex);
+        return 0;
+    }
     
-    // Synchroniser avec la matrice
-    if (user_id < MAX_USERS && item_id < MAX_ITEMS) {
-        rec_system.user_item_matrix[user_id][item_id] = (int)(rating * 10); // Scale 0-50
-        
-        // Mettre à jour les compteurs
-        if (user_id >= rec_system.num_users) {
-            rec_system.num_users = user_id + 1;
-        }
-        if (item_id >= rec_system.num_items) {
-            rec_system.num_items = item_id + 1;
-        }
+    // Le store sera reconstruit à la prochaine requête ; le modèle KNN et
+    // les lignes touchées de sa table sont mis à jour tout de suite
+    // (reconstruits plus tard en cas d'échec). Les fichiers précalculés ne
+    // correspondent plus aux données.
+    rec_system.store_dirty = 1;
+    rec_system.fingerprint = 0;
+    if (rec_system.knn != NULL && rec_system.knn_table != NULL &&
+        (knn_model_add_rating(rec_system.knn, user, item, encode_rating(rating) / 10.0) != 0 ||
+         knn_table_update(rec_system.knn_table, rec_system.knn, user, item) != 0 ||
+         update_knn_hnsw(user) != 0)) {
+        reset_knn_model();
     }
+    rec_system.num_users = rec_system.users.size;
+    rec_system.num_items = rec_system.items.size;
     
-    rec_system.num_ratings++;
+    // Le modèle MF publié intègre la note tout de suite (les requêtes MF
+    // le lisent sous data_mutex)
+    mf_model_t *mf = mf_slot_acquire(&mf_trainer.slot);
+    fold_in_mf_user(mf, user);
+    mf_model_release(mf);
     
     pthread_mutex_unlock(&rec_system.data_mutex);
     return 1;
@@ -424,228 +627,528 @@ void get_recommendations(recommendation_request_t* request, recommendation_resul
         case ALGO_GRAPH:
             graph_recommendation(request->user_id, results, num_results, request->num_recommendations);
             break;
+        case ALGO_ITEM_KNN:
+            item_knn_recommendation(request->user_id, results, num_results, request->num_recommendations);
+            break;
         default:
             log_message("Unknown recommendation algorithm: %d", request->algorithm);
             break;
     }
 }
 
-ndarray_t rating_to_aray(rating_t *ratings, size_t rows, size_t cols)
-{
-    ndarray_t result = array(rows, cols);
-    for(int i = 0; i<rows; i++)
-    { 
-        set(ratings, i, 0, (double)ratings[i].user_id);
-        set(ratings, i, 1, (double)ratings[i].item_id);
-        set(ratings, i, 2, (double)ratings[i].category_id);
-        set(ratings, i, 3, (double)ratings[i].rating);
-        set(ratings, i, 4, (double)ratings[i].timestamp);
-    } 
-   return result;
-}
-
+void knn_recommendation(long user_id, int k, recommendation_result_t* results, int* num_results, int max_results) {
+    // k vient du client : une valeur nulle ou négative prend la valeur par
+    // défaut, quelle que soit la source des voisins
+    if (k <= 0) {
+        k = DEFAULT_K;
+    }
 
-void knn_recommendation(int user_id, int k, recommendation_result_t* results, int* num_results, int max_results) {
     pthread_mutex_lock(&rec_system.data_mutex);
+    *num_results = 0;
+    
+    // Le modèle est construit au chargement ; reconstruction si add_rating() n'a pas pu le mettre à jour
+    if (rec_system.knn == NULL || rec_system.knn_table == NULL) {
+        reset_knn_model();
+        refresh_rating_store();
+        if (build_knn_model() != 0) {
+            pthread_mutex_unlock(&rec_system.data_mutex);
+            return;
+        }
+    }
+    knn_model_t *model = rec_system.knn;
     
-    // Create user-item matrix from rec_system
-    ndarray_t rating_matrix = array(rec_system.num_users, rec_system.num_items);
-    if (!rating_matrix.data) {
-        log_message("Failed to allocate rating matrix for KNN");
+    uint32_t user = id_map_find(&rec_system.users, (uint64_t)user_id);
+    if (user_id < 0 || user == ID_MAP_NONE || user >= model->num_users) {
+        log_message("Invalid user ID: %ld", user_id);
         pthread_mutex_unlock(&rec_system.data_mutex);
-        *num_results = 0;
         return;
     }
-
-    // Fill the matrix: 0.0 for unrated, actual rating otherwise
-    for (int u = 0; u < rec_system.num_users; u++) {
-        for (int i = 0; i < rec_system.num_items; i++) {
-            if (rec_system.user_item_matrix[u][i] >= 0) {
-                // Convert back from integer representation
-                set(&rating_matrix, u, i, rec_system.user_item_matrix[u][i] / 10.0);
-            } else {
-                set(&rating_matrix, u, i, 0.0);
-            }
-        }
+    
+    // Voisinage calculé une seule fois pour tous les items candidats : pris
+    // dans l'index HNSW s'il existe, sinon lu dans la table précalculée,
+    // sauf si k dépasse sa largeur
+    knn_neighborhood_t neighborhood;
+    int rc;
+    if (rec_system.knn_hnsw != NULL) {
+        rc = knn_hnsw_neighborhood(model, rec_system.knn_hnsw, user, k, &neighborhood);
+    } else if ((size_t)k <= rec_system.knn_table->k) {
+        rc = knn_table_neighborhood(rec_system.knn_table, model, user, k, &neighborhood);
+    } else {
+        rc = knn_model_neighborhood(model, user, k, &neighborhood);
     }
-
-    // Initialize KNN model
-    knn_t *model = init_knn(k);
-    if (!model) {
-        log_message("Failed to initialize KNN model");
-        free_array(&rating_matrix);
+    if (rc != 0) {
+        log_message("Failed to compute KNN neighborhood");
         pthread_mutex_unlock(&rec_system.data_mutex);
-        *num_results = 0;
         return;
     }
+    
+    // Classement de tous les items non notés, puis sélection des meilleurs
+    topn_t top;
+    if (topn_init(&top, max_results > 0 ? max_results : 0) != 0 ||
+        knn_neighborhood_rank(model, &neighborhood, &top) != 0) {
+        log_message("Failed to rank KNN candidates");
+    }
+    
+    size_t recommendations = topn_finish(&top);
+    for (size_t i = 0; i < recommendations; i++) {
+        results[*num_results].item_id = id_map_external(&rec_system.items, top.heap[i].id);
+        results[*num_results].category_id = -1; // Not available in this context
+        results[*num_results].predicted_rating = top.heap[i].score;
+        (*num_results)++;
+    }
+    topn_free(&top);
 
-    // Fit the model with the rating matrix
-    model = fitx(model, rating_matrix);
-    if (!model) {
-        log_message("Failed to fit KNN model");
-        free_knn(model);
-        free_array(&rating_matrix);
+    knn_neighborhood_free(&neighborhood);
+    pthread_mutex_unlock(&rec_system.data_mutex);
+}
+
+void item_knn_recommendation(long user_id, recommendation_result_t* results, int* num_results, int max_results) {
+    pthread_mutex_lock(&rec_system.data_mutex);
+    *num_results = 0;
+    
+    // L'index item-item est stable : reconstruit en tâche de fond quand le
+    // journal a assez grandi depuis sa construction, l'index courant est
+    // servi jusqu'au remplacement
+    size_t rebuild_at = rec_system.item_knn_ratings + rec_system.item_knn_ratings * ITEM_KNN_REBUILD_PERCENT / 100;
+    if (rec_system.item_knn == NULL || rec_system.log.size > rebuild_at) {
+        request_item_knn_rebuild();
+    }
+    if (rec_system.knn == NULL || rec_system.knn_table == NULL) {
+        reset_knn_model();
+        refresh_rating_store();
+        build_knn_model();
+    }
+    if (rec_system.item_knn == NULL || rec_system.knn == NULL) {
         pthread_mutex_unlock(&rec_system.data_mutex);
-        *num_results = 0;
         return;
     }
+    
+    uint32_t user = id_map_find(&rec_system.users, (uint64_t)user_id);
+    if (user_id < 0 || user == ID_MAP_NONE || user >= rec_system.knn->num_users) {
+        log_message("Invalid user ID: %ld", user_id);
+        pthread_mutex_unlock(&rec_system.data_mutex);
+        return;
+    }
+    
+    // Profil courant du user (le modèle KNN suit add_rating())
+    const knn_profile_t *profile = &rec_system.knn->profiles[user];
+    topn_t top;
+    if (topn_init(&top, max_results > 0 ? max_results : 0) != 0 ||
+        item_knn_rank(rec_system.item_knn, profile->items, profile->ratings, profile->len, &top) != 0) {
+        log_message("Failed to rank item-item KNN candidates");
+    }
+    
+    size_t recommendations = topn_finish(&top);
+    for (size_t i = 0; i < recommendations; i++) {
+        results[*num_results].item_id = id_map_external(&rec_system.items, top.heap[i].id);
+        results[*num_results].category_id = -1; // Not available in this context
+        results[*num_results].predicted_rating = top.heap[i].score;
+        (*num_results)++;
+    }
+    topn_free(&top);
+    
+    pthread_mutex_unlock(&rec_system.data_mutex);
+}
 
-    // Predict ratings for unrated items
-    *num_results = 0;
-    for (int item_id = 0; item_id < rec_system.num_items; item_id++) {
-        // Skip if user has already rated this item
-        if (rec_system.user_item_matrix[user_id][item_id] >= 0) {
-            continue;
+// Copie des notes du journal (data_mutex tenu) : l'entraînement travaille
+// ensuite sur cette copie, sans verrou
+static mf_sample_t *copy_mf_samples(size_t *num_samples) {
+    mf_sample_t *samples = malloc((rec_system.log.size ? rec_system.log.size : 1) * sizeof(mf_sample_t));
+    if (samples == NULL) {
+        return NULL;
+    }
+    size_t n = 0;
+    for (size_t s = 0; s < rating_log_num_segments(&rec_system.log); s++) {
+        rating_columns_t col = rating_log_segment(&rec_system.log, s);
+        for (size_t i = 0; i < col.len; i++, n++) {
+            samples[n].user = col.user[i];
+            samples[n].item = col.item[i];
+            samples[n].rating = col.rating[i] / 10.0f;
         }
+    }
+    *num_samples = n;
+    return samples;
+}
 
-        // Only recommend up to max_results
-        if (*num_results >= max_results) {
-            break;
+// Repli du user dans model à partir de son profil courant (data_mutex
+// tenu) : ses nouvelles notes comptent sans attendre le réentraînement
+static int fold_in_mf_user(mf_model_t *model, uint32_t user) {
+    if (model == NULL || rec_system.knn == NULL || user >= rec_system.knn->num_users) {
+        return -1;
+    }
+    const knn_profile_t *profile = &rec_system.knn->profiles[user];
+    return mf_fold_in_user(model, user, profile->items, profile->ratings, profile->len, MF_REGULARIZATION);
+}
+
+// Réentraîne si aucun modèle n'est publié, si le journal a assez grandi, ou
+// sur demande (user inconnu du modèle) si le journal a changé depuis
+static int train_mf_model(int requested) {
+    pthread_mutex_lock(&rec_system.data_mutex);
+    mf_model_t *current = mf_slot_acquire(&mf_trainer.slot);
+    size_t size = rec_system.log.size;
+    size_t retrain_at = current ? current->num_ratings + current->num_ratings * MF_RETRAIN_PERCENT / 100 : 0;
+    int stale = current == NULL ? size > 0 : size > retrain_at || (requested && size > current->num_ratings);
+    mf_model_release(current);
+    if (!stale) {
+        pthread_mutex_unlock(&rec_system.data_mutex);
+        return 0;
+    }
+
+    size_t num_samples = 0;
+    mf_sample_t *samples = copy_mf_samples(&num_samples);
+    size_t num_users = rec_system.users.size, num_items = rec_system.items.size;
+    uint64_t *user_ids = malloc((num_users + num_items + 1) * sizeof(uint64_t));
+    if (user_ids != NULL) {
+        memcpy(user_ids, rec_system.users.external, num_users * sizeof(uint64_t));
+        memcpy(user_ids + num_users, rec_system.items.external, num_items * sizeof(uint64_t));
+    }
+    unsigned long generation = mf_trainer.generation;
+    pthread_mutex_unlock(&rec_system.data_mutex);
+    if (samples == NULL || user_ids == NULL) {
+        log_message("Failed to copy ratings for MF training");
+        free(samples);
+        free(user_ids);
+        return -1;
+    }
+
+    // Entraînement hors verrou sur le pool de l'entraîneur ; les index sont
+    // déjà denses, le modèle est indexé comme le store
+    mf_params_t params = { MF_FACTORS, MF_LEARNING_RATE, MF_REGULARIZATION, MF_EPOCHS, &mf_trainer.pool, 0,
+                           MF_SOLVER };
+    if (params.solver == MF_SOLVER_ALS) {
+        params.epochs = MF_ALS_ITERATIONS;
+    }
+    mf_model_t *model = mf_train_samples(samples, num_samples, num_users, num_items, &params);
+    free(samples);
+    if (model == NULL) {
+        log_message("Matrix factorization failed");
+        free(user_ids);
+        return -1;
+    }
+    // Le seuil de réentraînement se mesure sur le journal
+    model->num_ratings = size;
+    build_mf_mips(model, &mf_trainer.pool);
+
+    // Sauvegardé tant qu'il est privé, pour être servi dès le prochain démarrage
+    if (mf_model_save(model, user_ids, user_ids + num_users, MF_MODEL_FILE) != 0) {
+        log_message("Failed to save MF model to %s", MF_MODEL_FILE);
+    }
+    free(user_ids);
+
+    pthread_mutex_lock(&rec_system.data_mutex);
+    if (generation == mf_trainer.generation) {
+        // Les users notés après la copie sont repliés avant la publication
+        size_t position = 0;
+        for (size_t seg = 0; seg < rating_log_num_segments(&rec_system.log); seg++) {
+            rating_columns_t col = rating_log_segment(&rec_system.log, seg);
+            for (size_t i = position < size ? size - position : 0; i < col.len; i++) {
+                fold_in_mf_user(model, col.user[i]);
+            }
+            position += col.len;
         }
+        mf_slot_publish(&mf_trainer.slot, model);
+        log_message("Published MF model v%llu trained on %zu ratings", (unsigned long long)model->version, size);
+    } else {
+        mf_model_release(model);
+    }
+    pthread_mutex_unlock(&rec_system.data_mutex);
+    return 0;
+}
 
-        double pred = predict_rating(model, user_id, item_id);
-        results[*num_results].item_id = item_id;
-        results[*num_results].category_id = -1; // Not available in this context
-        results[*num_results].predicted_rating = pred;
-        (*num_results)++;
+// Index MIPS des items d'un modèle pas encore publié, pour les grands
+// catalogues ; sans index, les recommandations scorent tous les items
+static int build_mf_mips(mf_model_t *model, thread_pool_t *pool) {
+    if (model->num_items < MF_MIPS_MIN_ITEMS) {
+        return 0;
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    model->mips = mf_mips_build(model, MF_MIPS_LISTS, pool);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (model->mips == NULL) {
+        log_message("Failed to build MF MIPS index, scoring all items");
+        return -1;
     }
+    log_message("Built MF MIPS index over %zu items (%zu lists, nprobe=%d) in %.3f s", model->num_items,
+                model->mips->num_lists, MF_MIPS_NPROBE,
+                (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    return 0;
+}
 
-    // Clean up
-    free_knn(model);
-    free_array(&rating_matrix);
+// Publie le modèle sauvegardé par un entraînement précédent, réindexé sur
+// les dictionnaires chargés : les requêtes MF sont servies dès le démarrage,
+// l'entraîneur ne réentraîne que si le journal a grandi depuis
+static void load_mf_model() {
+    pthread_mutex_lock(&rec_system.data_mutex);
+    mf_model_t *model = mf_model_load(MF_MODEL_FILE, &rec_system.users, &rec_system.items);
+    if (model != NULL && model->num_ratings > rec_system.log.size) {
+        log_message("Ignoring %s: built from other ratings", MF_MODEL_FILE);
+        mf_model_release(model);
+        model = NULL;
+    }
+    if (model != NULL) {
+        build_mf_mips(model, &rec_system.pool);
+        mf_slot_publish(&mf_trainer.slot, model);
+        log_message("Loaded MF model v%llu from %s (%zu users, %zu items, k=%zu, %zu ratings)",
+                    (unsigned long long)model->version, MF_MODEL_FILE, model->num_users, model->num_items,
+                    model->k, model->num_ratings);
+    }
     pthread_mutex_unlock(&rec_system.data_mutex);
 }
 
-void matrix_factorization_recommendation(int user_id, 
-                                         recommendation_result_t* results, 
-                                         int* num_results, 
-                                         int max_results) {
+// Reconstruit l'index item-item si le journal a assez grandi : les notes
+// sont copiées sous data_mutex, le store et l'index sont construits hors
+// verrou, puis l'index remplace l'ancien
+static int rebuild_item_knn() {
     pthread_mutex_lock(&rec_system.data_mutex);
-    
-    // Convert ratings to ndarray format
-    ndarray_t ratings = array(rec_system.num_ratings, 5);
-    if (!ratings.data) {
-        log_message("Failed to allocate ratings array");
+    size_t size = rec_system.log.size;
+    size_t rebuild_at = rec_system.item_knn_ratings + rec_system.item_knn_ratings * ITEM_KNN_REBUILD_PERCENT / 100;
+    if (size == 0 || (rec_system.item_knn != NULL && size <= rebuild_at)) {
         pthread_mutex_unlock(&rec_system.data_mutex);
-        *num_results = 0;
+        return 0;
+    }
+
+    uint32_t *users = malloc(size * sizeof(uint32_t));
+    uint32_t *items = malloc(size * sizeof(uint32_t));
+    uint8_t *values = malloc(size);
+    if (users != NULL && items != NULL && values != NULL) {
+        size_t n = 0;
+        for (size_t seg = 0; seg < rating_log_num_segments(&rec_system.log); seg++) {
+            rating_columns_t col = rating_log_segment(&rec_system.log, seg);
+            memcpy(users + n, col.user, col.len * sizeof(uint32_t));
+            memcpy(items + n, col.item, col.len * sizeof(uint32_t));
+            memcpy(values + n, col.rating, col.len);
+            n += col.len;
+        }
+    }
+    size_t num_users = rec_system.users.size, num_items = rec_system.items.size;
+    unsigned long generation = mf_trainer.generation;
+    pthread_mutex_unlock(&rec_system.data_mutex);
+
+    rating_store_t store = {0};
+    item_knn_t *index = malloc(sizeof(item_knn_t));
+    int rc = users == NULL || items == NULL || values == NULL || index == NULL ||
+             store_build(&store, users, items, values, size, num_users, num_items) != 0 ||
+             item_knn_build(index, &store, ITEM_KNN_M, SIM_ADJUSTED_COSINE) != 0 ? -1 : 0;
+    store_free(&store);
+    free(users);
+    free(items);
+    free(values);
+    if (rc != 0) {
+        log_message("Failed to build item-item KNN index");
+        free(index);
+        return -1;
+    }
+
+    pthread_mutex_lock(&rec_system.data_mutex);
+    if (generation == mf_trainer.generation) {
+        reset_item_knn();
+        rec_system.item_knn = index;
+        rec_system.item_knn_ratings = size;
+        log_message("Rebuilt item-item KNN index on %zu ratings", size);
+    } else {
+        item_knn_free(index);
+        free(index);
+    }
+    pthread_mutex_unlock(&rec_system.data_mutex);
+    return 0;
+}
+
+static void *mf_trainer_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&mf_trainer.mutex);
+    while (!mf_trainer.stop) {
+        int requested = mf_trainer.requested;
+        mf_trainer.requested = 0;
+        mf_trainer.item_knn_requested = 0;
+        pthread_mutex_unlock(&mf_trainer.mutex);
+
+        train_mf_model(requested);
+        rebuild_item_knn();
+
+        // Vérification périodique, ou plus tôt sur demande
+        pthread_mutex_lock(&mf_trainer.mutex);
+        if (!mf_trainer.stop && !mf_trainer.requested && !mf_trainer.item_knn_requested) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += MF_TRAIN_INTERVAL;
+            pthread_cond_timedwait(&mf_trainer.wake, &mf_trainer.mutex, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&mf_trainer.mutex);
+    return NULL;
+}
+
+static void request_mf_training() {
+    pthread_mutex_lock(&mf_trainer.mutex);
+    mf_trainer.requested = 1;
+    pthread_cond_signal(&mf_trainer.wake);
+    pthread_mutex_unlock(&mf_trainer.mutex);
+}
+
+static void request_item_knn_rebuild() {
+    pthread_mutex_lock(&mf_trainer.mutex);
+    mf_trainer.item_knn_requested = 1;
+    pthread_cond_signal(&mf_trainer.wake);
+    pthread_mutex_unlock(&mf_trainer.mutex);
+}
+
+static void start_mf_trainer() {
+    if (pool_init(&mf_trainer.pool, WORKER_THREADS) != 0) {
+        log_message("Failed to start MF training pool, training on one thread");
+    }
+    mf_trainer.stop = 0;
+    mf_trainer.requested = 1;
+    if (pthread_create(&mf_trainer.thread, NULL, mf_trainer_main, NULL) != 0) {
+        log_message("Failed to start MF trainer thread");
+        pool_free(&mf_trainer.pool);
         return;
     }
-    
-    for (int i = 0; i < rec_system.num_ratings; i++) {
-        set(&ratings, i, 0, (double)rec_system.ratings[i].user_id);
-        set(&ratings, i, 1, (double)rec_system.ratings[i].item_id);
-        set(&ratings, i, 2, (double)rec_system.ratings[i].category_id);
-        set(&ratings, i, 3, (double)rec_system.ratings[i].rating);
-        set(&ratings, i, 4, (double)rec_system.ratings[i].timestamp);
+    mf_trainer.started = 1;
+}
+
+static void stop_mf_trainer() {
+    if (!mf_trainer.started) {
+        return;
     }
+    pthread_mutex_lock(&mf_trainer.mutex);
+    mf_trainer.stop = 1;
+    pthread_cond_signal(&mf_trainer.wake);
+    pthread_mutex_unlock(&mf_trainer.mutex);
+    pthread_join(mf_trainer.thread, NULL);
+    pool_free(&mf_trainer.pool);
+    mf_trainer.started = 0;
+}
+
+// user a-t-il déjà noté item ? Lu dans les profils du modèle KNN, que
+// add_rating() tient à jour : le store n'est pas reconstruit sur le chemin
+// des requêtes. Sans modèle KNN, le store doit être à jour (data_mutex tenu).
+static int user_rated(uint32_t user, uint32_t item) {
+    if (rec_system.knn != NULL) {
+        return knn_model_rating(rec_system.knn, user, item) >= 0.0;
+    }
+    return user < rec_system.store.num_users && store_get(&rec_system.store, user, item) >= 0;
+}
+
+// Items déjà notés, écartés des recommandations MIPS (data_mutex tenu)
+static int is_rated(void *arg, size_t user, uint32_t item) {
+    (void)arg;
+    return user_rated((uint32_t)user, item);
+}
+
+void matrix_factorization_recommendation(long user_id, 
+                                         recommendation_result_t* results, 
+                                         int* num_results, 
+                                         int max_results) {
+    *num_results = 0;
     
-    // Save to temp file for MF processing
-    save_ndarray(&ratings, "server/data/temp_ratings.txt");
-    
-    // Train MF model
-    ndarray_t full_matrix = MF("server/data/temp_ratings.txt", 64, 10, 0.01, 0.1, 20);
-    if (full_matrix.shape[0] == 0) {
-        log_message("Matrix factorization failed");
-        free_array(&ratings);
+    // Dernier modèle complet publié par l'entraîneur ; s'il n'y en a pas
+    // encore ou s'il ne connaît pas ce user, un entraînement est demandé
+    mf_model_t *model = mf_slot_acquire(&mf_trainer.slot);
+    pthread_mutex_lock(&rec_system.data_mutex);
+    if (rec_system.knn == NULL) {
+        refresh_rating_store();
+    }
+    uint32_t user = id_map_find(&rec_system.users, (uint64_t)user_id);
+    if (model == NULL || user_id < 0 || user == ID_MAP_NONE || user >= model->num_users) {
         pthread_mutex_unlock(&rec_system.data_mutex);
-        *num_results = 0;
+        if (model == NULL || (user_id >= 0 && user != ID_MAP_NONE)) {
+            log_message("MF model not ready for user %ld, training requested", user_id);
+            request_mf_training();
+        }
+        mf_model_release(model);
         return;
     }
     
-    // Get recommendations for this user
-    *num_results = 0;
-    for (int item_id = 0; item_id < full_matrix.shape[1]; item_id++) {
-        // Skip if user has already rated this item
-        if (user_id < rec_system.num_users && 
-            item_id < rec_system.num_items && 
-            rec_system.user_item_matrix[user_id][item_id] >= 0) {
-            continue;
+    // Get recommendations for this user: best predicted unrated items,
+    // from the MIPS index's most promising lists on large catalogs,
+    // otherwise scored in one pass over the item factors
+    topn_t top;
+    float *scores = model->mips ? NULL : malloc((model->num_items ? model->num_items : 1) * sizeof(float));
+    if ((scores != NULL || model->mips != NULL) && topn_init(&top, max_results > 0 ? max_results : 0) == 0) {
+        if (model->mips != NULL) {
+            mf_mips_search(model->mips, model, user, MF_MIPS_NPROBE, is_rated, NULL, &top);
+        } else if (mf_score_user(model, user, NULL, model->num_items, scores) == 0) {
+            for (size_t item_id = 0; item_id < model->num_items; item_id++) {
+                // Skip if user has already rated this item
+                if (!user_rated(user, (uint32_t)item_id)) {
+                    topn_push(&top, (uint32_t)item_id, scores[item_id]);
+                }
+            }
         }
         
-        // Only recommend up to max_results
-        if (*num_results >= max_results) {
-            break;
+        size_t recommendations = topn_finish(&top);
+        for (size_t i = 0; i < recommendations; i++) {
+            results[*num_results].item_id = id_map_external(&rec_system.items, top.heap[i].id);
+            results[*num_results].category_id = -1; // Not available in this context
+            results[*num_results].predicted_rating = top.heap[i].score;
+            (*num_results)++;
         }
-        
-        double pred_rating = full_matrix.data[user_id][item_id];
-        results[*num_results].item_id = item_id;
-        results[*num_results].category_id = -1; // Not available in this context
-        results[*num_results].predicted_rating = pred_rating;
-        (*num_results)++;
+        topn_free(&top);
     }
+    free(scores);
     
-    // Clean up
-    free_array(&full_matrix);
-    free_array(&ratings);
     pthread_mutex_unlock(&rec_system.data_mutex);
+    mf_model_release(model);
 }
 
 
 
-void graph_recommendation(int user_id, recommendation_result_t* results, int* num_results, int max_results) {
+void graph_recommendation(long user_id, recommendation_result_t* results, int* num_results, int max_results) {
     pthread_mutex_lock(&rec_system.data_mutex);
+    // Le graphe est construit sur le store à chaque requête (déjà O(nnz)) :
+    // il doit inclure les dernières notes
+    refresh_rating_store();
     
     *num_results = 0;
     
     // Vérifier si l'utilisateur existe
-    if (user_id < 0 || user_id >= rec_system.num_users) {
-        log_message("Invalid user ID: %d", user_id);
+    uint32_t user = id_map_find(&rec_system.users, (uint64_t)user_id);
+    if (user_id < 0 || user == ID_MAP_NONE) {
+        log_message("Invalid user ID: %ld", user_id);
         pthread_mutex_unlock(&rec_system.data_mutex);
         return;
     }
 
-    // Initialiser le graphe bipartite
+    // Initialiser le graphe bipartite sur le store (seuls les ratings positifs
+    // sont des interactions)
     b_graph_t graph;
-    init_graph(&graph, rec_system.num_users, rec_system.num_items);
-    
-    // Ajouter les interactions utilisateur-item
-    for (int i = 0; i < rec_system.num_ratings; i++) {
-        rating_t r = rec_system.ratings[i];
-        if (r.rating > 0.0) { // Considérer seulement les ratings positifs
-            add_interaction(&graph, r.user_id, r.item_id);
-        }
+    init_graph_from_store(&graph, &rec_system.store);
+    if (graph.pr == NULL) {
+        log_message("Failed to allocate PageRank scores for graph");
+        free_graph(&graph);
+        pthread_mutex_unlock(&rec_system.data_mutex);
+        return;
     }
 
     // Exécuter l'algorithme PageRank
     run_pagerank(&graph);
 
-    // Créer un tableau pour les scores des items
-    ItemScore items[MAX_ITEMS];
-    int count = 0;
-    
-    // Collecter les items non notés par l'utilisateur
-    for (int item_id = 0; item_id < rec_system.num_items; item_id++) {
-        // Vérifier si l'utilisateur n'a pas noté cet item
-        if (rec_system.user_item_matrix[user_id][item_id] < 0) {
-            items[count].item_id = item_id;
-            items[count].score = graph.pr[graph.num_users + item_id];
-            count++;
-        }
+    // Garder les meilleurs items non notés par l'utilisateur. Les scores
+    // couvrent les items du store, qui peut être en retard sur les
+    // dictionnaires si sa reconstruction a échoué.
+    topn_t top;
+    if (topn_init(&top, max_results > 0 ? max_results : 0) != 0) {
+        log_message("Failed to allocate item scores for graph");
+        free_graph(&graph);
+        pthread_mutex_unlock(&rec_system.data_mutex);
+        return;
     }
-
-    // Trier les items par score décroissant (tri par sélection)
-    for (int i = 0; i < count - 1; i++) {
-        int max_idx = i;
-        for (int j = i + 1; j < count; j++) {
-            if (items[j].score > items[max_idx].score) {
-                max_idx = j;
-            }
-        }
-        if (max_idx != i) {
-            ItemScore temp = items[i];
-            items[i] = items[max_idx];
-            items[max_idx] = temp;
+    for (int item_id = 0; item_id < graph.num_items; item_id++) {
+        if (!user_rated(user, (uint32_t)item_id)) {
+            topn_push(&top, item_id, graph.pr[graph.num_users + item_id]);
         }
     }
 
-    // Sélectionner les top-N recommandations
-    int recommendations = (max_results < count) ? max_results : count;
-    for (int i = 0; i < recommendations; i++) {
-        results[*num_results].item_id = items[i].item_id;
+    size_t recommendations = topn_finish(&top);
+    for (size_t i = 0; i < recommendations; i++) {
+        results[*num_results].item_id = id_map_external(&rec_system.items, top.heap[i].id);
         results[*num_results].category_id = -1; // À remplir si disponible
-        results[*num_results].predicted_rating = items[i].score;
+        results[*num_results].predicted_rating = top.heap[i].score;
         (*num_results)++;
     }
 
+    topn_free(&top);
+    free_graph(&graph);
     pthread_mutex_unlock(&rec_system.data_mutex);
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <knn/knn.h>
+
+#include "header.h"
+
+// Calcule la table des M voisins les plus similaires de chaque user ou de
+// chaque item, par blocs de lignes écrits au fur et à mesure.
+// Usage: build_allpairs [users|items] [M] [output] [threads] [block_rows]
+int main(int argc, char *argv[])
+{
+    allpairs_options_t options;
+    memset(&options, 0, sizeof(options));
+    options.side = (argc > 1 && strcmp(argv[1], "users") == 0) ? ALLPAIRS_USERS : ALLPAIRS_ITEMS;
+    options.similarity = options.side == ALLPAIRS_USERS ? SIM_PEARSON : SIM_ADJUSTED_COSINE;
+    options.m = argc > 2 ? (size_t)atol(argv[2]) : ITEM_KNN_M;
+    const char *output = argc > 3 ? argv[3]
+                       : options.side == ALLPAIRS_USERS ? USER_PAIRS_FILE : ITEM_PAIRS_FILE;
+    size_t num_threads = argc > 4 ? (size_t)atol(argv[4]) : WORKER_THREADS;
+    options.block_rows = argc > 5 ? (size_t)atol(argv[5]) : 0;
+    if (options.block_rows == 0) {
+        options.block_rows = ALLPAIRS_BLOCK_ROWS;
+    }
+
+    dataset_t data = {0};
+    thread_pool_t pool = {0};
+    int status = EXIT_FAILURE;
+
+    if (dataset_load(&data, SNAPSHOT_FILE, RATINGS_FILE) != 0) {
+        goto done;
+    }
+
+    if (pool_init(&pool, num_threads) != 0) {
+        fprintf(stderr, "Error: Failed to start worker threads\n");
+        goto done;
+    }
+    options.pool = &pool;
+    options.fingerprint = data.fingerprint;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (allpairs_build(&data.store, &options, output) != 0) {
+        fprintf(stderr, "Error: Failed to build similarity table\n");
+        goto done;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("Wrote %s: %zu %s x %zu neighbors in %.3f s (%zu threads, blocks of %zu rows)\n", output,
+           options.side == ALLPAIRS_USERS ? data.store.num_users : data.store.num_items,
+           options.side == ALLPAIRS_USERS ? "users" : "items", options.m,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9, pool_size(&pool),
+           options.block_rows);
+    status = EXIT_SUCCESS;
+
+done:
+    pool_free(&pool);
+    dataset_free(&data);
+    return status;
+}
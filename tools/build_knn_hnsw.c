@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <knn/knn.h>
+
+#include "header.h"
+
+// Construit l'index HNSW des users sur les mêmes données que le serveur
+// (snapshot si présent, sinon fichier texte) et l'écrit avec leur empreinte :
+// le serveur le charge au démarrage au lieu de l'insérer user par user.
+// Usage: build_knn_hnsw [knn_hnsw.bin]
+int main(int argc, char *argv[])
+{
+    const char *output = argc > 1 ? argv[1] : KNN_HNSW_FILE;
+
+    dataset_t data = {0};
+    knn_model_t *model = NULL;
+    hnsw_t index = {0};
+    int status = EXIT_FAILURE;
+
+    if (dataset_load(&data, SNAPSHOT_FILE, RATINGS_FILE) != 0) {
+        goto done;
+    }
+
+    model = knn_model_build(&data.store);
+    if (model == NULL) {
+        fprintf(stderr, "Error: Failed to initialize KNN model\n");
+        goto done;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    hnsw_init(&index, KNN_HNSW_M, KNN_HNSW_EF_CONSTRUCTION, KNN_HNSW_EF_SEARCH, knn_model_distance, model);
+    for (uint32_t u = 0; u < model->num_users; u++) {
+        if (hnsw_insert(&index, u) != 0) {
+            fprintf(stderr, "Error: Failed to build HNSW index\n");
+            goto done;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    index.fingerprint = data.fingerprint;
+    if (hnsw_save(&index, output) != 0) {
+        goto done;
+    }
+    printf("Wrote %s: %zu users, M=%zu, efConstruction=%zu in %.3f s\n", output, index.num_nodes, index.m,
+           index.ef_construction, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    status = EXIT_SUCCESS;
+
+done:
+    hnsw_free(&index);
+    knn_model_free(model);
+    dataset_free(&data);
+    return status;
+}
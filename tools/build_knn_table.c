@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <knn/knn.h>
+
+#include "header.h"
+
+// Précalcule la table des K meilleurs voisins de chaque user à partir des
+// mêmes données que le serveur (snapshot si présent, sinon fichier texte),
+// une ligne par tâche sur un pool de threads.
+// Usage: build_knn_table [K] [knn_table.bin] [threads]
+int main(int argc, char *argv[])
+{
+    size_t k = argc > 1 ? (size_t)atol(argv[1]) : KNN_TABLE_K;
+    const char *output = argc > 2 ? argv[2] : KNN_TABLE_FILE;
+    size_t num_threads = argc > 3 ? (size_t)atol(argv[3]) : WORKER_THREADS;
+
+    dataset_t data = {0};
+    knn_model_t *model = NULL;
+    knn_table_t table = {0};
+    thread_pool_t pool = {0};
+    int status = EXIT_FAILURE;
+
+    if (dataset_load(&data, SNAPSHOT_FILE, RATINGS_FILE) != 0) {
+        goto done;
+    }
+
+    model = knn_model_build(&data.store);
+    if (model == NULL || knn_table_init(&table, model->num_users, k) != 0) {
+        fprintf(stderr, "Error: Failed to initialize KNN model\n");
+        goto done;
+    }
+
+    if (pool_init(&pool, num_threads) != 0) {
+        fprintf(stderr, "Error: Failed to start worker threads\n");
+        goto done;
+    }
+    model->pool = &pool;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (knn_table_build(&table, model) != 0) {
+        fprintf(stderr, "Error: Failed to build KNN table\n");
+        goto done;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    table.fingerprint = data.fingerprint;
+    if (knn_table_save(&table, output) != 0) {
+        goto done;
+    }
+    printf("Wrote %s: %zu users x %zu neighbors in %.3f s (%zu threads)\n", output, table.num_users,
+           table.k, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9, pool_size(&pool));
+    status = EXIT_SUCCESS;
+
+done:
+    pool_free(&pool);
+    knn_table_free(&table);
+    knn_model_free(model);
+    dataset_free(&data);
+    return status;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <knn/knn.h>
+
+#include "header.h"
+
+static double elapsed(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Construit l'index HNSW des users sur les données du serveur et mesure,
+// pour plusieurs valeurs de efSearch, le rappel@K par rapport aux K plus
+// proches exacts (même distance) et la latence moyenne d'une requête.
+// Usage: hnsw_report [K] [queries] [index.bin]
+int main(int argc, char *argv[])
+{
+    static const size_t ef_values[] = { 10, 20, 50, 100, 200, 400 };
+    size_t k = argc > 1 ? (size_t)atol(argv[1]) : KNN_TABLE_K;
+    size_t num_queries = argc > 2 ? (size_t)atol(argv[2]) : 200;
+    const char *output = argc > 3 ? argv[3] : NULL;
+
+    dataset_t data = {0};
+    knn_model_t *model = NULL;
+    hnsw_t index = {0};
+    uint32_t *queries = NULL;
+    uint32_t *exact = NULL;
+    topn_t top = {0};
+    int status = EXIT_FAILURE;
+
+    if (dataset_load(&data, SNAPSHOT_FILE, RATINGS_FILE) != 0) {
+        goto done;
+    }
+
+    model = knn_model_build(&data.store);
+    if (model == NULL || model->num_users < 2) {
+        fprintf(stderr, "Error: Failed to initialize KNN model\n");
+        goto done;
+    }
+    if (k > model->num_users - 1) {
+        k = model->num_users - 1;
+    }
+    if (num_queries > model->num_users) {
+        num_queries = model->num_users;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    hnsw_init(&index, KNN_HNSW_M, KNN_HNSW_EF_CONSTRUCTION, KNN_HNSW_EF_SEARCH, knn_model_distance, model);
+    for (uint32_t u = 0; u < model->num_users; u++) {
+        if (hnsw_insert(&index, u) != 0) {
+            fprintf(stderr, "Error: Failed to build HNSW index\n");
+            goto done;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("HNSW index: %zu users, M=%zu, efConstruction=%zu, built in %.3f s\n",
+           index.num_nodes, index.m, index.ef_construction, elapsed(&start, &end));
+
+    if (output != NULL) {
+        index.fingerprint = data.fingerprint;
+        if (hnsw_save(&index, output) != 0) {
+            goto done;
+        }
+        printf("Wrote %s\n", output);
+    }
+
+    // Requêtes réparties sur tous les users ; vérité terrain par balayage
+    queries = malloc(num_queries * sizeof(uint32_t));
+    exact = malloc(num_queries * k * sizeof(uint32_t));
+    if (queries == NULL || exact == NULL || topn_init(&top, k) != 0) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        goto done;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t q = 0; q < num_queries; q++) {
+        queries[q] = (uint32_t)(q * model->num_users / num_queries);
+        for (uint32_t v = 0; v < model->num_users; v++) {
+            if (v != queries[q]) {
+                topn_push(&top, v, 1.0 - knn_model_distance(model, queries[q], v));
+            }
+        }
+        size_t len = topn_finish(&top);
+        for (size_t i = 0; i < k; i++) {
+            exact[q * k + i] = i < len ? top.heap[i].id : KNN_TABLE_NONE;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Exact scan: %.3f ms/query\n\n", elapsed(&start, &end) * 1e3 / num_queries);
+
+    printf("%10s %12s %14s\n", "efSearch", "recall@K", "ms/query");
+    for (size_t e = 0; e < sizeof(ef_values) / sizeof(ef_values[0]); e++) {
+        index.ef_search = ef_values[e];
+        size_t found = 0, expected = 0;
+        double seconds = 0.0;
+
+        for (size_t q = 0; q < num_queries; q++) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            hnsw_search(&index, queries[q], k, &top);
+            size_t len = topn_finish(&top);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            seconds += elapsed(&start, &end);
+
+            for (size_t i = 0; i < k; i++) {
+                if (exact[q * k + i] == KNN_TABLE_NONE) {
+                    continue;
+                }
+                expected++;
+                for (size_t j = 0; j < len; j++) {
+                    if (top.heap[j].id == exact[q * k + i]) {
+                        found++;
+                        break;
+                    }
+                }
+            }
+        }
+        printf("%10zu %12.4f %14.4f\n", ef_values[e], expected ? (double)found / expected : 1.0,
+               seconds * 1e3 / num_queries);
+    }
+    printf("\n(K=%zu, %zu queries)\n", k, num_queries);
+    status = EXIT_SUCCESS;
+
+done:
+    topn_free(&top);
+    free(exact);
+    free(queries);
+    hnsw_free(&index);
+    knn_model_free(model);
+    dataset_free(&data);
+    return status;
+}
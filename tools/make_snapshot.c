@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "header.h"
+
+// Convertit un fichier de ratings texte (user;item;category;rating;timestamp)
+// en snapshot binaire chargeable par mmap au démarrage du serveur. Le
+// fichier écrit est relu et vérifié en entier (snapshot_verify()), ce que le
+// serveur ne fait pas à l'ouverture.
+// Usage: make_snapshot [ratings.txt] [ratings.snap] [threads]
+int main(int argc, char *argv[])
+{
+    const char *input = argc > 1 ? argv[1] : RATINGS_FILE;
+    const char *output = argc > 2 ? argv[2] : SNAPSHOT_FILE;
+    int num_threads = argc > 3 ? atoi(argv[3]) : 0;
+
+    id_map_t users = {0};
+    id_map_t items = {0};
+    rating_log_t log = {0};
+    rating_store_t store = {0};
+    ingest_stats_t stats;
+    int status = EXIT_FAILURE;
+
+    struct timespec start, parsed, done;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (ingest_ratings_file(input, num_threads, &users, &items, &log, &stats) != 0) {
+        fprintf(stderr, "Error: Failed to load ratings data from %s\n", input);
+        goto done;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &parsed);
+
+    if (store_build_from_log(&store, &log, users.size, items.size) != 0) {
+        fprintf(stderr, "Error: Failed to build rating store\n");
+        goto done;
+    }
+
+    if (snapshot_write(output, &users, &items, &log, &store) != 0) {
+        goto done;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &done);
+
+    dataset_t written = {0};
+    int verified = snapshot_open(output, &written.snapshot, &written.users, &written.items, &written.log,
+                                 &written.store) == 0 && snapshot_verify(&written.snapshot) == 0;
+    dataset_free(&written);
+    if (!verified) {
+        fprintf(stderr, "Error: Snapshot %s does not read back\n", output);
+        goto done;
+    }
+
+    printf("Parsed %zu lines (%zu rejected) in %.3f s\n", stats.lines, stats.rejected,
+           (parsed.tv_sec - start.tv_sec) + (parsed.tv_nsec - start.tv_nsec) / 1e9);
+    printf("Wrote %s: %zu ratings, %zu users, %zu items, %zu distinct pairs in %.3f s\n",
+           output, log.size, users.size, items.size, store.nnz,
+           (done.tv_sec - start.tv_sec) + (done.tv_nsec - start.tv_nsec) / 1e9);
+    status = EXIT_SUCCESS;
+
+done:
+    store_free(&store);
+    rating_log_free(&log);
+    id_map_free(&users);
+    id_map_free(&items);
+    return status;
+}
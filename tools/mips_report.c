@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mf/mf.h>
+
+#include "header.h"
+
+static double elapsed(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Construit l'index MIPS des items du modèle MF (celui du disque s'il existe,
+// sinon un modèle entraîné sur les données du serveur) et mesure, pour
+// plusieurs valeurs de nprobe, le rappel@N par rapport au top N exact, la
+// part des items scorés et la latence d'une requête face au score de tous
+// les items.
+// Usage: mips_report [N] [queries] [lists]
+int main(int argc, char *argv[])
+{
+    static const size_t nprobe_values[] = { 1, 2, 4, 8, 16, 32, 64 };
+    size_t n = argc > 1 ? (size_t)atol(argv[1]) : MAX_RECOMMENDATIONS;
+    size_t num_queries = argc > 2 ? (size_t)atol(argv[2]) : 200;
+    size_t num_lists = argc > 3 ? (size_t)atol(argv[3]) : MF_MIPS_LISTS;
+
+    dataset_t data = {0};
+    thread_pool_t pool = {0};
+    mf_model_t *model = NULL;
+    uint32_t *queries = NULL;
+    uint32_t *exact = NULL;
+    float *scores = NULL;
+    topn_t top = {0};
+    int status = EXIT_FAILURE;
+
+    if (dataset_load(&data, SNAPSHOT_FILE, RATINGS_FILE) != 0) {
+        goto done;
+    }
+    if (pool_init(&pool, WORKER_THREADS) != 0) {
+        fprintf(stderr, "Error: Failed to start worker threads\n");
+        goto done;
+    }
+
+    model = mf_model_load(MF_MODEL_FILE, &data.users, &data.items);
+    if (model != NULL) {
+        printf("Loaded %s\n", MF_MODEL_FILE);
+    } else {
+        mf_params_t params = { MF_FACTORS, MF_LEARNING_RATE, MF_REGULARIZATION, MF_ALS_ITERATIONS, &pool, 0,
+                               MF_SOLVER_ALS };
+        model = mf_train_store(&data.store, &params);
+    }
+    if (model == NULL || model->num_users == 0 || model->num_items == 0) {
+        fprintf(stderr, "Error: No MF model\n");
+        goto done;
+    }
+    if (n > model->num_items) {
+        n = model->num_items;
+    }
+    if (num_queries > model->num_users) {
+        num_queries = model->num_users;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    model->mips = mf_mips_build(model, num_lists, &pool);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (model->mips == NULL) {
+        fprintf(stderr, "Error: Failed to build MIPS index\n");
+        goto done;
+    }
+    printf("MIPS index: %zu items, k=%zu, %zu lists, built in %.3f s\n", model->num_items, model->k,
+           model->mips->num_lists, elapsed(&start, &end));
+
+    // Requêtes réparties sur tous les users ; vérité terrain par score de
+    // tous les items (le chemin du serveur sans index)
+    queries = malloc(num_queries * sizeof(uint32_t));
+    exact = malloc((num_queries * n + 1) * sizeof(uint32_t));
+    scores = malloc(model->num_items * sizeof(float));
+    if (queries == NULL || exact == NULL || scores == NULL || topn_init(&top, n) != 0) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        goto done;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t q = 0; q < num_queries; q++) {
+        queries[q] = (uint32_t)(q * model->num_users / num_queries);
+        mf_score_user(model, queries[q], NULL, model->num_items, scores);
+        for (uint32_t i = 0; i < model->num_items; i++) {
+            topn_push(&top, i, scores[i]);
+        }
+        size_t len = topn_finish(&top);
+        for (size_t i = 0; i < n; i++) {
+            exact[q * n + i] = i < len ? top.heap[i].id : ID_MAP_NONE;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double exact_ms = elapsed(&start, &end) * 1e3 / num_queries;
+    printf("Exact scan: %.4f ms/query\n\n", exact_ms);
+
+    printf("%10s %12s %12s %14s %10s\n", "nprobe", "recall@N", "scored", "ms/query", "speedup");
+    for (size_t e = 0; e < sizeof(nprobe_values) / sizeof(nprobe_values[0]); e++) {
+        size_t nprobe = nprobe_values[e];
+        size_t found = 0, expected = 0, scored = 0;
+        double seconds = 0.0;
+
+        for (size_t q = 0; q < num_queries; q++) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            long count = mf_mips_search(model->mips, model, queries[q], nprobe, NULL, NULL, &top);
+            size_t len = topn_finish(&top);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            seconds += elapsed(&start, &end);
+            scored += count > 0 ? (size_t)count : 0;
+
+            for (size_t i = 0; i < n; i++) {
+                if (exact[q * n + i] == ID_MAP_NONE) {
+                    continue;
+                }
+                expected++;
+                for (size_t j = 0; j < len; j++) {
+                    if (top.heap[j].id == exact[q * n + i]) {
+                        found++;
+                        break;
+                    }
+                }
+            }
+        }
+        double ms = seconds * 1e3 / num_queries;
+        printf("%10zu %12.4f %11.2f%% %14.4f %9.1fx\n", nprobe, expected ? (double)found / expected : 1.0,
+               100.0 * scored / ((double)num_queries * model->num_items), ms, ms > 0 ? exact_ms / ms : 0.0);
+        if (nprobe >= model->mips->num_lists) {
+            break;
+        }
+    }
+    printf("\n(N=%zu, %zu queries)\n", n, num_queries);
+    status = EXIT_SUCCESS;
+
+done:
+    topn_free(&top);
+    free(scores);
+    free(exact);
+    free(queries);
+    mf_model_free(model);
+    pool_free(&pool);
+    dataset_free(&data);
+    return status;
+}
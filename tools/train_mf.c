@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mf/mf.h>
+
+#include "header.h"
+
+// Entraîne le modèle MF sur les mêmes données que le serveur (snapshot si
+// présent, sinon fichier texte) et l'écrit au format lu par mf_model_load() :
+// le serveur le projette au démarrage au lieu de réentraîner. Le fichier
+// écrit est relu pour vérifier son checksum, que le serveur ne recalcule
+// pas ; "check" vérifie seulement un fichier existant.
+// Usage: train_mf [als|sgd] [mf_model.bin] [threads] [iterations]
+//        train_mf check [mf_model.bin]
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "check") == 0) {
+        const char *path = argc > 2 ? argv[2] : MF_MODEL_FILE;
+        if (mf_model_verify(path) != 0) {
+            return EXIT_FAILURE;
+        }
+        printf("%s: checksum OK\n", path);
+        return EXIT_SUCCESS;
+    }
+
+    mf_params_t params = { MF_FACTORS, MF_LEARNING_RATE, MF_REGULARIZATION, MF_EPOCHS, NULL, 0, MF_SOLVER };
+    if (argc > 1) {
+        if (strcmp(argv[1], "als") == 0) {
+            params.solver = MF_SOLVER_ALS;
+        } else if (strcmp(argv[1], "sgd") == 0) {
+            params.solver = MF_SOLVER_SGD;
+        } else {
+            fprintf(stderr, "Usage: %s [als|sgd|check] [mf_model.bin] [threads] [iterations]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    params.epochs = params.solver == MF_SOLVER_ALS ? MF_ALS_ITERATIONS : MF_EPOCHS;
+    const char *output = argc > 2 ? argv[2] : MF_MODEL_FILE;
+    size_t num_threads = argc > 3 ? (size_t)atol(argv[3]) : WORKER_THREADS;
+    if (argc > 4) {
+        params.epochs = (size_t)atol(argv[4]);
+    }
+
+    dataset_t data = {0};
+    thread_pool_t pool = {0};
+    mf_model_t *model = NULL;
+    int status = EXIT_FAILURE;
+
+    if (dataset_load(&data, SNAPSHOT_FILE, RATINGS_FILE) != 0) {
+        goto done;
+    }
+
+    if (pool_init(&pool, num_threads) != 0) {
+        fprintf(stderr, "Error: Failed to start worker threads\n");
+        goto done;
+    }
+    params.pool = &pool;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    model = mf_train_store(&data.store, &params);
+    if (model == NULL) {
+        fprintf(stderr, "Error: Matrix factorization failed\n");
+        goto done;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Même seuil de réentraînement que l'entraîneur du serveur
+    model->num_ratings = data.log.size;
+    if (mf_model_save(model, data.users.external, data.items.external, output) != 0 ||
+        mf_model_verify(output) != 0) {
+        goto done;
+    }
+    printf("Wrote %s: %zu users x %zu items, k=%zu in %.3f s (%zu threads)\n", output, model->num_users,
+           model->num_items, model->k, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9,
+           pool_size(&pool));
+    status = EXIT_SUCCESS;
+
+done:
+    mf_model_free(model);
+    pool_free(&pool);
+    dataset_free(&data);
+    return status;
+}